@@ -0,0 +1,642 @@
+#include "pressuredistsolver.hpp"
+#include "csv_reader.hpp"
+#include "edge_series.hpp"
+#include "time_series_engine.hpp"
+#include "resource_usage.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 性能計測プログラム
+//
+// 合成データで次の処理時間を計測し、表と機械可読な形式（JSON/CSV）で出力する。
+//   csv_read        CSVReader::readCSV（行数を変えた合成CSV）
+//   factorize       buildAndFactorizeMatrix()（格子点数 n×n を変えて）
+//   solve           solveWithCachedMatrix()
+//   total_force     calculateTotalForce()
+//   force_operator  buildForceOperator()
+//   series_operator 境界圧力CSVの読み込みからオペレータでの合力計算まで（ステップ数を変えて）
+//   series_full     同じく全ステップで圧力場を解く場合
+// solveでは各辺に線形な圧力を与え、解析解 p = a + b·x + c·y との誤差も記録する
+// （一様膜厚では格子によらず丸め誤差の範囲で一致する）。
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+using Vector = SquareThinFilmFDM::Vector;
+using Backend = SquareThinFilmFDM::SolverBackend;
+
+// 1ケースあたりの計測時間の上限（これを超えたら指定回数に満たなくても打ち切る）
+constexpr double kMaxSecondsPerCase = 10.0;
+
+// 全ステップで圧力場を解く時系列の最大ステップ数
+constexpr size_t kMaxFullSolveSteps = 10000;
+
+// 解析解 p = a + b·x + c·y の係数 [Pa], [Pa/m]
+constexpr double kLinearA = 2000.0;
+constexpr double kLinearB = 15000.0;
+constexpr double kLinearC = -8000.0;
+
+// 計算領域（main と同じ）
+constexpr double kWidth = 0.1;
+constexpr double kHeight = 0.13;
+
+/**
+ * 1つの計測結果
+ */
+struct BenchRecord {
+    std::string benchmark;   // 計測対象
+    std::string backend;     // ソルバーのバックエンド（CSV読み込みは空）
+    int nx = 0;              // x方向の格子点数（CSV読み込みは0）
+    int ny = 0;              // y方向の格子点数
+    size_t items = 0;        // 処理量（未知数・行数・ステップ数）
+    int repeats = 0;         // 計測回数
+    double median_s = 0.0;   // 中央値 [s]
+    double min_s = 0.0;      // 最小値 [s]
+    double max_s = 0.0;      // 最大値 [s]
+    size_t peak_rss = 0;     // 計測中の常駐メモリの最大値 [byte]
+    double max_error = std::numeric_limits<double>::quiet_NaN();   // 解析解との最大誤差（相対）
+    double force_error = std::numeric_limits<double>::quiet_NaN(); // 解析解との合力の誤差（相対）
+};
+
+/**
+ * 計測の設定
+ */
+struct BenchOptions {
+    std::vector<int> sizes = {50, 100, 200, 500, 1000, 2000};
+    std::vector<size_t> csv_rows = {10000, 100000, 1000000};
+    std::vector<size_t> series_steps = {1000, 10000, 100000};
+    int series_grid = 100;
+    int repeats = 5;
+    double time_budget = 120.0;   // 次の格子の分解がこれを超えると見込まれたら打ち切る [s]
+    Backend backend = Backend::Auto;
+    bool wedge_film = false;
+    int num_threads = 0;
+    std::string json_file;
+    std::string csv_file;
+};
+
+struct Timing {
+    int repeats = 0;
+    double median_s = 0.0;
+    double min_s = 0.0;
+    double max_s = 0.0;
+};
+
+/**
+ * 処理を繰り返し実行して時間を計測する
+ * @param repeats 計測回数（合計が kMaxSecondsPerCase を超えたら打ち切る、最低1回）
+ * @param setup 各回の前処理（計測に含めない、nullptr可）
+ * @param body 計測する処理（falseを返したら失敗として中断）
+ * @param timing 計測結果
+ * @return すべての回が成功したかどうか
+ */
+bool measure(int repeats, const std::function<void()>& setup,
+             const std::function<bool()>& body, Timing& timing) {
+    std::vector<double> samples;
+    double total = 0.0;
+    for (int r = 0; r < std::max(repeats, 1); ++r) {
+        if (setup) {
+            setup();
+        }
+        auto start = Clock::now();
+        bool ok = body();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        if (!ok) {
+            return false;
+        }
+        samples.push_back(elapsed);
+        total += elapsed;
+        if (total > kMaxSecondsPerCase) {
+            break;
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t count = samples.size();
+    timing.repeats = static_cast<int>(count);
+    timing.min_s = samples.front();
+    timing.max_s = samples.back();
+    timing.median_s = (count % 2 == 1) ? samples[count / 2]
+                                       : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+    return true;
+}
+
+BenchRecord makeRecord(const std::string& benchmark, const std::string& backend,
+                       int nx, int ny, size_t items, const Timing& timing) {
+    BenchRecord record;
+    record.benchmark = benchmark;
+    record.backend = backend;
+    record.nx = nx;
+    record.ny = ny;
+    record.items = items;
+    record.repeats = timing.repeats;
+    record.median_s = timing.median_s;
+    record.min_s = timing.min_s;
+    record.max_s = timing.max_s;
+    record.peak_rss = resource_usage::peakResidentBytes();
+    return record;
+}
+
+const char* backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Auto: return "auto";
+        case Backend::SparseLU: return "lu";
+        case Backend::Spectral: return "spectral";
+        case Backend::Multigrid: return "multigrid";
+        case Backend::ConjugateGradient: return "cg";
+        case Backend::SimplicialLDLT: return "ldlt";
+        case Backend::MatrixFreeCG: return "matrix-free-cg";
+        case Backend::MixedPrecisionLU: return "mixed";
+    }
+    return "unknown";
+}
+
+bool parseBackend(const std::string& text, Backend& backend) {
+    for (Backend b : {Backend::Auto, Backend::SparseLU, Backend::Spectral, Backend::Multigrid,
+                      Backend::ConjugateGradient, Backend::SimplicialLDLT, Backend::MatrixFreeCG,
+                      Backend::MixedPrecisionLU}) {
+        if (text == backendName(b)) {
+            backend = b;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+bool parseList(const std::string& text, std::vector<T>& values) {
+    values.clear();
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        char* end = nullptr;
+        long long value = std::strtoll(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || value <= 0) {
+            return false;
+        }
+        values.push_back(static_cast<T>(value));
+    }
+    return !values.empty();
+}
+
+std::unique_ptr<SquareThinFilmFDM> makeSolver(int n, const BenchOptions& options) {
+    SquareThinFilmFDM::HeightFunction film = nullptr;
+    if (options.wedge_film) {
+        // x方向に厚さが半分になるくさび膜
+        film = [](double x, double) { return 0.001 * (1.0 - 0.5 * x / kWidth); };
+    }
+    // 速度0: くさび膜でもy方向にだけ線形な解は厳密解になる
+    auto solver = std::make_unique<SquareThinFilmFDM>(n, kWidth, kHeight, film, 0.01, 0.0);
+    solver->setSolverBackend(options.backend);
+    return solver;
+}
+
+// 解析解 p = a + b·x + c·y（くさび膜では b = 0）
+double linearSolution(double x, double y, bool wedge_film) {
+    return kLinearA + (wedge_film ? 0.0 : kLinearB) * x + kLinearC * y;
+}
+
+void setLinearEdges(SquareThinFilmFDM& solver, bool wedge_film) {
+    const Vector& x = solver.getXCoordinates();
+    const Vector& y = solver.getYCoordinates();
+    Vector bottom(x.size()), top(x.size()), left(y.size()), right(y.size());
+    for (Eigen::Index j = 0; j < x.size(); ++j) {
+        bottom(j) = linearSolution(x(j), 0.0, wedge_film);
+        top(j) = linearSolution(x(j), kHeight, wedge_film);
+    }
+    for (Eigen::Index i = 0; i < y.size(); ++i) {
+        left(i) = linearSolution(0.0, y(i), wedge_film);
+        right(i) = linearSolution(kWidth, y(i), wedge_film);
+    }
+    solver.setEdgeProfiles(bottom, right, top, left);
+}
+
+// 解析解との誤差（圧力場の最大誤差と合力の誤差、いずれも相対値）
+void checkLinearSolution(const SquareThinFilmFDM& solver, bool wedge_film, BenchRecord& record) {
+    const auto& P = solver.getPressureField();
+    const Vector& x = solver.getXCoordinates();
+    const Vector& y = solver.getYCoordinates();
+    double max_error = 0.0;
+    double max_value = 0.0;
+    for (Eigen::Index j = 0; j < x.size(); ++j) {
+        for (Eigen::Index i = 0; i < y.size(); ++i) {
+            double exact = linearSolution(x(j), y(i), wedge_film);
+            max_error = std::max(max_error, std::abs(P(i, j) - exact));
+            max_value = std::max(max_value, std::abs(exact));
+        }
+    }
+    // 線形関数は台形則で厳密に積分できる
+    double exact_force = linearSolution(0.5 * kWidth, 0.5 * kHeight, wedge_film) * kWidth * kHeight;
+    record.max_error = max_error / max_value;
+    record.force_error = std::abs(solver.calculateTotalForce() - exact_force) / std::abs(exact_force);
+}
+
+// 境界圧力CSVの形式（simulation_time, pressure_ave ほか）の合成ファイルを書く
+void writeEdgeCSV(const fs::path& filename, size_t rows, double phase) {
+    std::ofstream file(filename);
+    file << "simulation_time,pressure_ave,pressure_min,pressure_max\n";
+    file << std::setprecision(10);
+    for (size_t r = 0; r < rows; ++r) {
+        double t = 1e-4 * static_cast<double>(r);
+        double p = 101325.0 + 5000.0 * std::sin(50.0 * t + phase);
+        file << t << ',' << p << ',' << p - 250.0 << ',' << p + 250.0 << '\n';
+    }
+}
+
+void writeEdgeDirectory(const fs::path& dir, size_t rows) {
+    fs::create_directories(dir);
+    writeEdgeCSV(dir / "bottompressure.csv", rows, 0.0);
+    writeEdgeCSV(dir / "rightpressure.csv", rows, 0.5);
+    writeEdgeCSV(dir / "toppressure.csv", rows, 1.0);
+    writeEdgeCSV(dir / "leftpressure.csv", rows, 1.5);
+}
+
+void printRecord(const BenchRecord& r) {
+    std::cout << std::left << std::setw(16) << r.benchmark << std::setw(10) << r.backend
+              << std::right << std::setw(6) << r.nx << std::setw(6) << r.ny
+              << std::setw(10) << r.items << std::setw(4) << r.repeats
+              << std::setw(13) << std::scientific << std::setprecision(3) << r.median_s
+              << std::setw(13) << r.median_s / static_cast<double>(std::max<size_t>(r.items, 1))
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << static_cast<double>(r.peak_rss) / (1024.0 * 1024.0);
+    if (!std::isnan(r.max_error)) {
+        std::cout << std::scientific << std::setprecision(2) << std::setw(11) << r.max_error
+                  << std::setw(11) << r.force_error;
+    }
+    std::cout << std::defaultfloat << std::endl;
+}
+
+// JSONの数値（非数はnull）
+std::string jsonNumber(double value) {
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    std::ostringstream out;
+    out << std::setprecision(17) << value;
+    return out.str();
+}
+
+bool writeJson(const std::string& filename, const std::vector<BenchRecord>& records,
+               const BenchOptions& options) {
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "JSONファイルを開けません: " << filename << std::endl;
+        return false;
+    }
+    file << "{\n";
+#ifdef NDEBUG
+    file << "  \"optimized\": true,\n";
+#else
+    file << "  \"optimized\": false,\n";
+#endif
+#ifdef __VERSION__
+    file << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+    file << "  \"eigen\": \"" << EIGEN_WORLD_VERSION << '.' << EIGEN_MAJOR_VERSION << '.'
+         << EIGEN_MINOR_VERSION << "\",\n";
+    file << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    file << "  \"threads\": " << options.num_threads << ",\n";
+    file << "  \"film\": \"" << (options.wedge_film ? "wedge" : "uniform") << "\",\n";
+    file << "  \"results\": [\n";
+    for (size_t k = 0; k < records.size(); ++k) {
+        const BenchRecord& r = records[k];
+        file << "    {\"benchmark\": \"" << r.benchmark << "\", \"backend\": \"" << r.backend
+             << "\", \"nx\": " << r.nx << ", \"ny\": " << r.ny << ", \"items\": " << r.items
+             << ", \"repeats\": " << r.repeats << ", \"median_s\": " << jsonNumber(r.median_s)
+             << ", \"min_s\": " << jsonNumber(r.min_s) << ", \"max_s\": " << jsonNumber(r.max_s)
+             << ", \"peak_rss_bytes\": " << r.peak_rss
+             << ", \"max_rel_error\": " << jsonNumber(r.max_error)
+             << ", \"force_rel_error\": " << jsonNumber(r.force_error) << "}"
+             << (k + 1 < records.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return static_cast<bool>(file);
+}
+
+bool writeCsv(const std::string& filename, const std::vector<BenchRecord>& records) {
+    std::ofstream file(filename);
+    if (!file) {
+        std::cerr << "CSVファイルを開けません: " << filename << std::endl;
+        return false;
+    }
+    file << "benchmark,backend,nx,ny,items,repeats,median_s,min_s,max_s,peak_rss_bytes,"
+            "max_rel_error,force_rel_error\n";
+    file << std::setprecision(17);
+    for (const BenchRecord& r : records) {
+        file << r.benchmark << ',' << r.backend << ',' << r.nx << ',' << r.ny << ',' << r.items << ','
+             << r.repeats << ',' << r.median_s << ',' << r.min_s << ',' << r.max_s << ','
+             << r.peak_rss << ',';
+        if (!std::isnan(r.max_error)) {
+            file << r.max_error << ',' << r.force_error;
+        } else {
+            file << ',';
+        }
+        file << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+// CSVReader::readCSV（全列）と列を指定した読み込み
+void benchCsvRead(const BenchOptions& options, const fs::path& work_dir,
+                  std::vector<BenchRecord>& records) {
+    CSVReader reader;
+    const std::vector<std::string> columns = {"simulation_time", "pressure_ave"};
+    for (size_t rows : options.csv_rows) {
+        fs::path file = work_dir / ("read_" + std::to_string(rows) + ".csv");
+        writeEdgeCSV(file, rows, 0.0);
+
+        Timing timing;
+        resource_usage::resetPeakResident();
+        measure(options.repeats, nullptr, [&]() {
+            return reader.readCSV(file.string()).num_rows == rows;
+        }, timing);
+        records.push_back(makeRecord("csv_read", "", 0, 0, rows, timing));
+        printRecord(records.back());
+
+        resource_usage::resetPeakResident();
+        measure(options.repeats, nullptr, [&]() {
+            return reader.readCSV(file.string(), columns).num_rows == rows;
+        }, timing);
+        records.push_back(makeRecord("csv_read_cols", "", 0, 0, rows, timing));
+        printRecord(records.back());
+
+        fs::remove(file);
+    }
+}
+
+// 格子点数を変えた分解・求解・合力積分・オペレータ構築
+void benchGridScaling(const BenchOptions& options, std::vector<BenchRecord>& records) {
+    double last_factorize = 0.0;
+    size_t last_unknowns = 0;
+    for (int n : options.sizes) {
+        size_t unknowns = static_cast<size_t>(n - 2) * static_cast<size_t>(n - 2);
+
+        // 2次元の疎行列の分解は未知数の1.5乗程度で増える
+        if (last_unknowns > 0) {
+            double predicted = last_factorize * std::pow(static_cast<double>(unknowns) / last_unknowns, 1.5);
+            if (predicted > options.time_budget) {
+                std::cout << "n=" << n << " 以降は省略（分解の見込み " << predicted << " s）" << std::endl;
+                break;
+            }
+        }
+
+        // 分解（毎回新しいソルバーで、記号分解も含めて計測）
+        std::unique_ptr<SquareThinFilmFDM> solver;
+        Timing timing;
+        resource_usage::resetPeakResident();
+        bool ok = measure(options.repeats, [&]() {
+            solver.reset();
+            solver = makeSolver(n, options);
+            setLinearEdges(*solver, options.wedge_film);
+        }, [&]() { return solver->buildAndFactorizeMatrix(); }, timing);
+        if (!ok) {
+            std::cerr << "n=" << n << " の分解に失敗しました" << std::endl;
+            break;
+        }
+        std::string backend = backendName(solver->getActiveBackend());
+        records.push_back(makeRecord("factorize", backend, n, n, unknowns, timing));
+        printRecord(records.back());
+        last_factorize = timing.min_s;
+        last_unknowns = unknowns;
+
+        // 求解と解析解との比較
+        resource_usage::resetPeakResident();
+        ok = measure(options.repeats, nullptr, [&]() { return solver->solveWithCachedMatrix(); }, timing);
+        if (!ok) {
+            std::cerr << "n=" << n << " の求解に失敗しました" << std::endl;
+            break;
+        }
+        records.push_back(makeRecord("solve", backend, n, n, unknowns, timing));
+        checkLinearSolution(*solver, options.wedge_film, records.back());
+        printRecord(records.back());
+
+        // 合力の積分（1回が短いのでまとめて計測し、1回あたりに換算）
+        const int inner = std::max(1, static_cast<int>(2e7 / (static_cast<double>(n) * n)));
+        volatile double sink = 0.0;
+        resource_usage::resetPeakResident();
+        measure(options.repeats, nullptr, [&]() {
+            for (int k = 0; k < inner; ++k) {
+                sink = sink + solver->calculateTotalForce();
+            }
+            return true;
+        }, timing);
+        timing.median_s /= inner;
+        timing.min_s /= inner;
+        timing.max_s /= inner;
+        records.push_back(makeRecord("total_force", backend, n, n, static_cast<size_t>(n) * n, timing));
+        printRecord(records.back());
+
+        // 境界値→合力オペレータ（随伴問題の求解）
+        resource_usage::resetPeakResident();
+        ok = measure(1, nullptr, [&]() { return solver->buildForceOperator(); }, timing);
+        if (ok) {
+            records.push_back(makeRecord("force_operator", backend, n, n, unknowns, timing));
+            printRecord(records.back());
+        }
+    }
+}
+
+// 境界圧力CSVの読み込みから合力の時系列まで
+void benchSeries(const BenchOptions& options, const fs::path& work_dir,
+                 std::vector<BenchRecord>& records) {
+    const int n = options.series_grid;
+    for (size_t steps : options.series_steps) {
+        fs::path dir = work_dir / ("series_" + std::to_string(steps));
+        writeEdgeDirectory(dir, steps);
+
+        // 既定のモード: CSVの読み込み、分解、オペレータ構築、各ステップの内積
+        std::string backend;
+        std::vector<double> forces;
+        Timing timing;
+        resource_usage::resetPeakResident();
+        bool ok = measure(options.repeats, nullptr, [&]() {
+            EdgePressureSeries series = loadEdgePressureSeries(dir.string(), TimeIndex::Interpolation::Nearest, false);
+            auto solver = makeSolver(n, options);
+            if (!solver->buildAndFactorizeMatrix() || !solver->buildForceOperator()) {
+                return false;
+            }
+            backend = backendName(solver->getActiveBackend());
+            forces.resize(series.size());
+            for (size_t i = 0; i < series.size(); ++i) {
+                forces[i] = solver->calculateForceFromEdges(series.bottom[i], series.right[i],
+                                                            series.top[i], series.left[i]);
+            }
+            return forces.size() == steps;
+        }, timing);
+        if (ok) {
+            records.push_back(makeRecord("series_operator", backend, n, n, steps, timing));
+            printRecord(records.back());
+        }
+
+        // 全ステップで圧力場を解くモード
+        if (steps <= kMaxFullSolveSteps) {
+            resource_usage::resetPeakResident();
+            ok = measure(options.repeats, nullptr, [&]() {
+                EdgePressureSeries series = loadEdgePressureSeries(dir.string(), TimeIndex::Interpolation::Nearest, false);
+                auto solver = makeSolver(n, options);
+                if (!solver->buildAndFactorizeMatrix()) {
+                    return false;
+                }
+                backend = backendName(solver->getActiveBackend());
+                if (solver->supportsConcurrentSolve()) {
+                    TimeSeriesEngine engine(*solver, options.num_threads);
+                    return engine.run(series.bottom, series.right, series.top, series.left, forces);
+                }
+                forces.resize(series.size());
+                for (size_t i = 0; i < series.size(); ++i) {
+                    solver->setEdgeBoundary(series.bottom[i], series.right[i], series.top[i], series.left[i]);
+                    if (!solver->solveWithCachedMatrix()) {
+                        return false;
+                    }
+                    forces[i] = solver->calculateTotalForce();
+                }
+                return true;
+            }, timing);
+            if (ok) {
+                records.push_back(makeRecord("series_full", backend, n, n, steps, timing));
+                printRecord(records.back());
+            }
+        }
+
+        fs::remove_all(dir);
+    }
+}
+
+void printUsage() {
+    std::cout <<
+        "使い方: PressureDistBench [オプション]\n"
+        "  --sizes N,N,...        格子点数 n（n×n、既定 50,100,200,500,1000,2000）\n"
+        "  --csv-rows N,N,...     CSV読み込みの行数（既定 10000,100000,1000000）\n"
+        "  --series-steps N,N,... 時系列のステップ数（既定 1000,10000,100000）\n"
+        "  --series-grid N        時系列の格子点数（既定 100）\n"
+        "  --repeat N             計測回数（既定 5、1ケース10秒で打ち切り）\n"
+        "  --time-budget S        分解がS秒を超えると見込まれる格子を省略（既定 120）\n"
+        "  --backend NAME         auto, lu, spectral, multigrid, cg, ldlt, matrix-free-cg, mixed\n"
+        "  --film uniform|wedge   膜厚分布（既定 uniform）\n"
+        "  --threads N            時系列の並列求解のスレッド数\n"
+        "  --quick                小さい設定で一通り実行する\n"
+        "  --only NAME,...        csv, grid, series のうち実行するもの\n"
+        "  --json FILE            結果をJSONで書き出す\n"
+        "  --csv FILE             結果をCSVで書き出す\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    bool run_csv = true;
+    bool run_grid = true;
+    bool run_series = true;
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool has_value = a + 1 < argc;
+        bool ok = true;
+        if (arg == "--sizes" && has_value) {
+            ok = parseList(argv[++a], options.sizes) &&
+                 std::all_of(options.sizes.begin(), options.sizes.end(), [](int n) { return n >= 3; });
+        } else if (arg == "--csv-rows" && has_value) {
+            ok = parseList(argv[++a], options.csv_rows);
+        } else if (arg == "--series-steps" && has_value) {
+            ok = parseList(argv[++a], options.series_steps);
+        } else if (arg == "--series-grid" && has_value) {
+            options.series_grid = std::atoi(argv[++a]);
+            ok = options.series_grid >= 3;
+        } else if (arg == "--repeat" && has_value) {
+            options.repeats = std::max(1, std::atoi(argv[++a]));
+        } else if (arg == "--time-budget" && has_value) {
+            options.time_budget = std::atof(argv[++a]);
+        } else if (arg == "--backend" && has_value) {
+            ok = parseBackend(argv[++a], options.backend);
+        } else if (arg == "--film" && has_value) {
+            std::string film = argv[++a];
+            ok = (film == "uniform" || film == "wedge");
+            options.wedge_film = (film == "wedge");
+        } else if (arg == "--threads" && has_value) {
+            options.num_threads = std::atoi(argv[++a]);
+        } else if (arg == "--quick") {
+            options.sizes = {50, 100, 200};
+            options.csv_rows = {10000, 100000};
+            options.series_steps = {1000, 10000};
+            options.series_grid = 50;
+            options.repeats = 3;
+        } else if (arg == "--only" && has_value) {
+            std::string only = argv[++a];
+            run_csv = only.find("csv") != std::string::npos;
+            run_grid = only.find("grid") != std::string::npos;
+            run_series = only.find("series") != std::string::npos;
+        } else if (arg == "--json" && has_value) {
+            options.json_file = argv[++a];
+        } else if (arg == "--csv" && has_value) {
+            options.csv_file = argv[++a];
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            std::cerr << "不明な引数: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "引数の値が不正です: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+#ifndef NDEBUG
+    std::cerr << "警告: 最適化なし（NDEBUG未定義）でビルドされています。"
+                 "-DCMAKE_BUILD_TYPE=Release でビルドしてください" << std::endl;
+#endif
+
+    // 合成データの作業ディレクトリ
+    std::random_device seed;
+    fs::path work_dir = fs::temp_directory_path() / ("pressuredist_bench_" + std::to_string(seed()));
+    fs::create_directories(work_dir);
+
+    std::cout << std::left << std::setw(16) << "benchmark" << std::setw(10) << "backend"
+              << std::right << std::setw(6) << "nx" << std::setw(6) << "ny"
+              << std::setw(10) << "items" << std::setw(4) << "rep"
+              << std::setw(13) << "median[s]" << std::setw(13) << "per item[s]"
+              << std::setw(10) << "RSS[MiB]" << std::setw(11) << "max err" << std::setw(11) << "force err"
+              << std::endl;
+
+    std::vector<BenchRecord> records;
+    try {
+        if (run_csv) {
+            benchCsvRead(options, work_dir, records);
+        }
+        if (run_grid) {
+            benchGridScaling(options, records);
+        }
+        if (run_series) {
+            benchSeries(options, work_dir, records);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "エラー: " << e.what() << std::endl;
+        fs::remove_all(work_dir);
+        return 1;
+    }
+    fs::remove_all(work_dir);
+
+    bool ok = true;
+    if (!options.json_file.empty()) {
+        ok = writeJson(options.json_file, records, options) && ok;
+    }
+    if (!options.csv_file.empty()) {
+        ok = writeCsv(options.csv_file, records) && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+#include "solver_client.hpp"
+#include "pressuredistsolver.hpp"
+#include "batch_runner.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// 常駐ソルバー（PressureDistSolver --serve）のクライアント
+//
+//   --edges B,R,T,L  各辺の圧力に対する合力を問い合わせて表示する
+//   --check          同じ格子をこのプロセスでも解き、サーバーの応答（合力・圧力分布・
+//                    エラー応答）が一致するか確かめる。一致しなければ終了コード1
+//   --latency N      合力の要求を N 回送り、1要求ずつ待つ場合の往復時間と
+//                    パイプライン（--depth 個を送ったまま）の処理速度を計測する
+//   --shutdown       最後にサーバーを終了させる
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using solver_protocol::GeometryRequest;
+using solver_protocol::Status;
+
+struct ClientOptions {
+    std::string socket_path = solver_protocol::kDefaultSocketPath;
+    GeometryRequest geometry{100, 100, 0.1, 0.13, 0.01, 1.0};  // mainと同じ
+    bool query = false;
+    double edges[4] = {0.0, 0.0, 0.0, 0.0};
+    bool check = false;
+    int check_states = 1000;
+    int latency_requests = 0;
+    int depth = 64;
+    bool shutdown = false;
+};
+
+// 乱数の境界圧力 [Pa]
+struct EdgeState {
+    double bottom, right, top, left;
+};
+
+std::vector<EdgeState> randomStates(int count, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> pressure(-2000.0, 8000.0);
+    std::vector<EdgeState> states(count);
+    for (EdgeState& s : states) {
+        s = {pressure(rng), pressure(rng), pressure(rng), pressure(rng)};
+    }
+    return states;
+}
+
+bool parseEdges(const std::string& text, double edges[4]) {
+    std::stringstream ss(text);
+    std::string item;
+    int count = 0;
+    while (std::getline(ss, item, ',')) {
+        if (count == 4) {
+            return false;
+        }
+        try {
+            edges[count++] = std::stod(item);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return count == 4;
+}
+
+bool relativeMatch(double a, double b, double tolerance) {
+    return std::abs(a - b) <= tolerance * std::max({1.0, std::abs(a), std::abs(b)});
+}
+
+// サーバーの応答をこのプロセスでの計算と比べる
+bool runCheck(SolverClient& client, const ClientOptions& options) {
+    constexpr double tolerance = 1e-12;
+    bool ok = true;
+    auto report = [&](bool passed, const std::string& name, const std::string& detail) {
+        std::cout << (passed ? "  ok   " : "  NG   ") << name << (detail.empty() ? "" : ": ") << detail << std::endl;
+        ok = ok && passed;
+    };
+
+    const GeometryRequest& g = options.geometry;
+    uint32_t handle = client.openGeometry(g);
+    report(client.openGeometry(g) == handle, "open_geometry", "handle " + std::to_string(handle));
+
+    SquareThinFilmFDM reference(g.nx, g.ny, g.width, g.height, nullptr, g.viscosity, g.velocity);
+    if (!reference.buildAndFactorizeMatrix() || !reference.buildForceOperator()) {
+        std::cerr << "比較用のソルバーを準備できません" << std::endl;
+        return false;
+    }
+
+    // 合力: 全要求を送ってから応答を受け取る（パイプライン）
+    std::vector<EdgeState> states = randomStates(options.check_states, 12345);
+    std::vector<uint32_t> ids;
+    for (const EdgeState& s : states) {
+        ids.push_back(client.submitForce(handle, s.bottom, s.right, s.top, s.left));
+    }
+    SolverClient::Reply reply;
+    size_t mismatched = 0, out_of_order = 0;
+    double max_error = 0.0;
+    for (size_t k = 0; k < states.size(); ++k) {
+        client.receive(reply);
+        const EdgeState& s = states[k];
+        double expected = reference.calculateForceFromEdges(s.bottom, s.right, s.top, s.left);
+        max_error = std::max(max_error, std::abs(reply.force - expected) / std::max(1.0, std::abs(expected)));
+        mismatched += reply.status != Status::Ok || !relativeMatch(reply.force, expected, tolerance);
+        out_of_order += reply.request_id != ids[k];
+    }
+    std::ostringstream detail;
+    detail << states.size() << " requests, max relative error " << max_error;
+    report(mismatched == 0 && out_of_order == 0, "solve_force", detail.str());
+
+    // 圧力分布: 合力オペレータではなく圧力場を解いた結果と比べる
+    double max_field_error = 0.0;
+    bool field_ok = true;
+    for (size_t k = 0; k < 3 && k < states.size(); ++k) {
+        const EdgeState& s = states[k];
+        SolverClient::Reply field = client.solveField(handle, s.bottom, s.right, s.top, s.left);
+        reference.setEdgeBoundary(s.bottom, s.right, s.top, s.left);
+        if (!reference.solveWithCachedMatrix()) {
+            std::cerr << "比較用のソルバーで解けません" << std::endl;
+            return false;
+        }
+        const SquareThinFilmFDM::Matrix& P = reference.getPressureField();
+        field_ok = field_ok && field.nx == g.nx && field.ny == g.ny &&
+                   relativeMatch(field.force, reference.calculateTotalForce(), tolerance) &&
+                   relativeMatch(field.force, reference.calculateForceFromEdges(s.bottom, s.right, s.top, s.left), 1e-9);
+        double scale = std::max(1.0, P.cwiseAbs().maxCoeff());
+        for (int i = 0; field_ok && i < g.ny; ++i) {
+            for (int j = 0; j < g.nx; ++j) {
+                max_field_error = std::max(max_field_error, std::abs(field.field[size_t(i) * g.nx + j] - P(i, j)) / scale);
+            }
+        }
+    }
+    detail.str("");
+    detail << "max relative error " << max_field_error;
+    report(field_ok && max_field_error <= tolerance, "solve_field", detail.str());
+
+    // エラー応答（接続はそのまま使える）
+    client.submitForce(handle + 1000, 0.0, 0.0, 0.0, 0.0);
+    client.receive(reply);
+    report(reply.status == Status::UnknownHandle, "unknown_handle", reply.error);
+    GeometryRequest invalid = g;
+    invalid.nx = 1;
+    bool rejected = false;
+    try {
+        client.openGeometry(invalid);
+    } catch (const std::exception&) {
+        rejected = true;
+    }
+    report(rejected, "invalid_geometry", "");
+    client.ping();
+    report(true, "ping_after_errors", "");
+
+    std::cout << (ok ? "OK" : "NG") << std::endl;
+    return ok;
+}
+
+// 往復時間とパイプラインの処理速度を計測する
+void runLatency(SolverClient& client, const ClientOptions& options) {
+    uint32_t handle = client.openGeometry(options.geometry);
+    std::vector<EdgeState> states = randomStates(options.latency_requests, 777);
+
+    std::vector<double> round_trips;
+    round_trips.reserve(states.size());
+    for (const EdgeState& s : states) {
+        Clock::time_point start = Clock::now();
+        client.solveForce(handle, s.bottom, s.right, s.top, s.left);
+        round_trips.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+    }
+    std::sort(round_trips.begin(), round_trips.end());
+    auto percentile = [&](double q) {
+        return round_trips[std::min(round_trips.size() - 1, static_cast<size_t>(q * round_trips.size()))] * 1e6;
+    };
+
+    // --depth 個を送ったまま、1つ受け取るごとに1つ送る
+    SolverClient::Reply reply;
+    size_t next = 0;
+    Clock::time_point start = Clock::now();
+    while (next < states.size() && client.pending() < static_cast<size_t>(options.depth)) {
+        const EdgeState& s = states[next++];
+        client.submitForce(handle, s.bottom, s.right, s.top, s.left);
+    }
+    while (client.pending() > 0) {
+        client.receive(reply);
+        if (next < states.size()) {
+            const EdgeState& s = states[next++];
+            client.submitForce(handle, s.bottom, s.right, s.top, s.left);
+        }
+    }
+    double pipelined = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "往復時間 [us]: 中央値 " << percentile(0.5) << ", 99% " << percentile(0.99)
+              << ", 最大 " << round_trips.back() * 1e6 << " (" << states.size() << " 要求)" << std::endl
+              << "パイプライン (深さ " << options.depth << "): " << std::setprecision(0)
+              << states.size() / pipelined << " 要求/秒, " << std::setprecision(2)
+              << pipelined / states.size() * 1e6 << " us/要求" << std::endl;
+}
+
+void printUsage() {
+    std::cout <<
+        "使い方: PressureDistClient [オプション]\n"
+        "  --socket PATH          ソケットファイル（既定 pressuredist.sock）\n"
+        "  --grid N|NXxNY         格子点数（既定 100）\n"
+        "  --width W --height H   領域の幅・高さ [m]（既定 0.1, 0.13）\n"
+        "  --viscosity MU         粘度 [Pa・s]（既定 0.01）\n"
+        "  --velocity U           すべり速度 [m/s]（既定 1.0）\n"
+        "  --edges B,R,T,L        各辺の圧力 [Pa] に対する合力を表示する\n"
+        "  --check [N]            N 個（既定 1000）の境界条件でサーバーの応答を確かめる\n"
+        "  --latency N            N 要求で往復時間とパイプラインの処理速度を計測する\n"
+        "  --depth D              パイプラインで応答を待たずに送る要求数（既定 64）\n"
+        "  --shutdown             最後にサーバーを終了させる\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    ClientOptions options;
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        bool has_value = a + 1 < argc;
+        bool ok = true;
+        if (arg == "--socket" && has_value) {
+            options.socket_path = argv[++a];
+        } else if (arg == "--grid" && has_value) {
+            int nx = 0, ny = 0;
+            ok = BatchRunner::parseGridSize(argv[++a], nx, ny);
+            options.geometry.nx = nx;
+            options.geometry.ny = ny;
+        } else if (arg == "--width" && has_value) {
+            options.geometry.width = std::atof(argv[++a]);
+        } else if (arg == "--height" && has_value) {
+            options.geometry.height = std::atof(argv[++a]);
+        } else if (arg == "--viscosity" && has_value) {
+            options.geometry.viscosity = std::atof(argv[++a]);
+        } else if (arg == "--velocity" && has_value) {
+            options.geometry.velocity = std::atof(argv[++a]);
+        } else if (arg == "--edges" && has_value) {
+            options.query = true;
+            ok = parseEdges(argv[++a], options.edges);
+        } else if (arg == "--check") {
+            options.check = true;
+            if (has_value && argv[a + 1][0] != '-') {
+                options.check_states = std::atoi(argv[++a]);
+                ok = options.check_states > 0;
+            }
+        } else if (arg == "--latency" && has_value) {
+            options.latency_requests = std::atoi(argv[++a]);
+            ok = options.latency_requests > 0;
+        } else if (arg == "--depth" && has_value) {
+            options.depth = std::atoi(argv[++a]);
+            ok = options.depth > 0;
+        } else if (arg == "--shutdown") {
+            options.shutdown = true;
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            std::cerr << "不明な引数: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "引数の値が不正です: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    try {
+        SolverClient client;
+        client.connect(options.socket_path);
+        client.ping();
+        if (options.query) {
+            uint32_t handle = client.openGeometry(options.geometry);
+            double force = client.solveForce(handle, options.edges[0], options.edges[1],
+                                             options.edges[2], options.edges[3]);
+            std::cout << std::setprecision(17) << force << std::endl;
+        }
+        if (options.check) {
+            ok = runCheck(client, options);
+        }
+        if (options.latency_requests > 0) {
+            runLatency(client, options);
+        }
+        if (options.shutdown) {
+            client.shutdown();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "エラー: " << e.what() << std::endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+#include "batch_runner.hpp"
+#include "pressuredistsolver.hpp"
+#include "csv_reader.hpp"
+#include "columnar_file.hpp"
+#include "edge_series.hpp"
+#include "instrumentation.hpp"
+#include "parallel_for.hpp"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <tuple>
+
+namespace {
+
+// カンマ区切りの数値リストを読む
+bool parseValueList(const std::string& token, std::vector<double>& values) {
+    values.clear();
+    std::stringstream ss(token);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        try {
+            size_t pos = 0;
+            double v = std::stod(item, &pos);
+            if (pos != item.size()) {
+                return false;
+            }
+            values.push_back(v);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+}
+
+BatchRunner::BatchRunner(int num_threads)
+    : num_threads(num_threads), interpolation(TimeIndex::Interpolation::Nearest),
+      use_csv_cache(true), write_csv(true), write_binary(false) {}
+
+bool BatchRunner::loadManifest(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "マニフェストを開けません: " << filename << std::endl;
+        return false;
+    }
+
+    std::filesystem::path base = std::filesystem::path(filename).parent_path();
+    std::set<std::string> output_paths;  // 既存のケースと合わせて出力ファイルの重複を調べる
+    for (const Case& c : cases) {
+        for (double mu : c.viscosities) {
+            for (double u : c.velocities) {
+                output_paths.insert(std::filesystem::path(outputFilename(c, mu, u)).lexically_normal().string());
+            }
+        }
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+
+        // コメントと空行を除く
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::stringstream ss(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (ss >> token) {
+            tokens.push_back(token);
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+
+        Case c;
+        bool ok = tokens.size() == 6;
+        if (ok) {
+            std::filesystem::path dir(tokens[0]);
+            c.input_dir = dir.is_absolute() ? dir.string() : (base / dir).string();
+            try {
+                ok = parseGridSize(tokens[1], c.nx, c.ny);
+                c.width = std::stod(tokens[2]);
+                c.height = std::stod(tokens[3]);
+            } catch (const std::exception&) {
+                ok = false;
+            }
+            ok = ok && c.width > 0.0 && c.height > 0.0
+                 && parseValueList(tokens[4], c.viscosities)
+                 && parseValueList(tokens[5], c.velocities);
+            for (double mu : c.viscosities) {
+                ok = ok && mu > 0.0;
+            }
+        }
+
+        if (!ok) {
+            std::cerr << filename << ":" << line_number << ": マニフェストの書式が不正です"
+                      << "（入力ディレクトリ 格子点数 幅 高さ 粘度 速度）" << std::endl;
+            return false;
+        }
+
+        // 別のスイープ点が同じファイルを上書きしないようにする
+        // （同じ入力ディレクトリの単一ケースが2行ある、スイープの値が重複している、など）
+        for (double mu : c.viscosities) {
+            for (double u : c.velocities) {
+                std::string path = std::filesystem::path(outputFilename(c, mu, u)).lexically_normal().string();
+                if (!output_paths.insert(path).second) {
+                    std::cerr << filename << ":" << line_number << ": 出力ファイルが他のスイープ点と重複しています: "
+                              << path << std::endl;
+                    return false;
+                }
+            }
+        }
+        cases.push_back(c);
+    }
+
+    return true;
+}
+
+bool BatchRunner::parseGridSize(const std::string& text, int& nx, int& ny) {
+    // "n"（n×n）または "NXxNY"
+    try {
+        size_t pos = 0;
+        nx = std::stoi(text, &pos);
+        ny = nx;
+        if (pos < text.size()) {
+            if (text[pos] != 'x') {
+                return false;
+            }
+            size_t rest = 0;
+            ny = std::stoi(text.substr(pos + 1), &rest);
+            if (pos + 1 + rest != text.size()) {
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return nx >= 3 && ny >= 3;
+}
+
+void BatchRunner::addCase(const Case& c) {
+    cases.push_back(c);
+}
+
+std::string BatchRunner::outputFilename(const Case& c, double mu, double u) {
+    std::filesystem::path dir = std::filesystem::path(c.input_dir) / "results";
+    if (c.viscosities.size() == 1 && c.velocities.size() == 1) {
+        return (dir / "pressure_force_results.csv").string();
+    }
+
+    // 値を往復で同じdoubleに戻る最短の表記にする（近い値のスイープ点が同じ名前にならない）
+    std::string name = "pressure_force_results_mu";
+    CSVReader::appendNumber(name, mu);
+    name += "_u";
+    CSVReader::appendNumber(name, u);
+    name += ".csv";
+    return (dir / name).string();
+}
+
+bool BatchRunner::run() const {
+    if (cases.empty()) {
+        std::cerr << "計算するケースがありません" << std::endl;
+        return false;
+    }
+
+    // 入力ディレクトリごとにCSVを一度だけ読み込む
+    std::map<std::string, size_t> dir_index;
+    std::vector<std::string> dirs;
+    for (const auto& c : cases) {
+        if (dir_index.emplace(c.input_dir, dirs.size()).second) {
+            dirs.push_back(c.input_dir);
+        }
+    }
+
+    std::vector<EdgePressureSeries> series(dirs.size());
+    std::vector<std::string> load_errors(dirs.size());
+    parallelFor(dirs.size(), num_threads, 1, [&](size_t begin, size_t end, int) {
+        for (size_t d = begin; d < end; ++d) {
+            try {
+                series[d] = loadEdgePressureSeries(dirs[d], interpolation, use_csv_cache);
+            } catch (const std::exception& e) {
+                load_errors[d] = e.what();
+            }
+        }
+    });
+
+    bool success = true;
+    for (size_t d = 0; d < dirs.size(); ++d) {
+        if (!load_errors[d].empty()) {
+            std::cerr << dirs[d] << " の読み込みに失敗しました: " << load_errors[d] << std::endl;
+            success = false;
+            continue;
+        }
+        std::filesystem::create_directories(std::filesystem::path(dirs[d]) / "results");
+    }
+
+    // 格子が同じケースをまとめ、分解と合力オペレータを共有する
+    std::map<std::tuple<int, int, double, double>, std::vector<size_t>> grid_groups;
+    for (size_t k = 0; k < cases.size(); ++k) {
+        const Case& c = cases[k];
+        if (load_errors[dir_index[c.input_dir]].empty()) {
+            grid_groups[std::make_tuple(c.nx, c.ny, c.width, c.height)].push_back(k);
+        }
+    }
+    std::vector<std::vector<size_t>> groups;
+    for (auto& entry : grid_groups) {
+        groups.push_back(std::move(entry.second));
+    }
+
+    std::cout << "ケース数: " << cases.size() << ", 入力ディレクトリ数: " << dirs.size()
+              << ", 分解数: " << groups.size() << std::endl;
+
+    // 1. 格子ごとに分解・合力オペレータを準備し、各スイープ点（ケース・粘度・速度）の
+    //    オペレータの係数を取り出す（粘度・速度の変更は O(格子点数) のスケーリングのみ）
+    struct SweepPoint {
+        size_t case_index;
+        double mu;
+        double u;
+        SquareThinFilmFDM::EdgeForceCoefficients coefficients;
+    };
+    std::vector<std::vector<SweepPoint>> group_points(groups.size());
+    std::atomic<bool> failed(false);
+    parallelFor(groups.size(), num_threads, 1, [&](size_t begin, size_t end, int) {
+        for (size_t g = begin; g < end; ++g) {
+            const Case& first = cases[groups[g].front()];
+            SquareThinFilmFDM solver(first.nx, first.ny, first.width, first.height, nullptr,
+                                     first.viscosities.front(), first.velocities.front());
+            bool built = operator_cache_dir.empty()
+                ? solver.buildAndFactorizeMatrix() && solver.buildForceOperator()
+                : solver.buildForceOperatorCached(operator_cache_dir);
+            if (!built) {
+                std::cerr << first.input_dir << " のシステム行列の構築・分解に失敗しました" << std::endl;
+                failed = true;
+                continue;
+            }
+
+            for (size_t k : groups[g]) {
+                const Case& c = cases[k];
+                for (double mu : c.viscosities) {
+                    // 粘度の変更は分解済みの解のスケーリングのみ
+                    solver.setViscosity(mu);
+                    for (double u : c.velocities) {
+                        solver.setVelocity(u);
+                        group_points[g].push_back({k, mu, u, solver.getEdgeForceCoefficients()});
+                    }
+                }
+            }
+        }
+    });
+
+    std::vector<SweepPoint> points;
+    for (auto& group : group_points) {
+        points.insert(points.end(), group.begin(), group.end());
+    }
+    std::cout << "スイープ点数: " << points.size() << std::endl;
+
+    // 2. スイープ点を全スレッドに分けて時系列を評価し、書き出す
+    //    （1つの格子で多数の粘度・速度を計算する場合もすべてのコアを使う）
+    std::atomic<size_t> runs_done(0);
+    parallelFor(points.size(), num_threads, 1, [&](size_t begin, size_t end, int) {
+        for (size_t p = begin; p < end; ++p) {
+            const SweepPoint& point = points[p];
+            const Case& c = cases[point.case_index];
+            const EdgePressureSeries& s = series[dir_index.at(c.input_dir)];
+
+            std::vector<double> forces(s.size());
+            {
+                PD_TRACE_SCOPE("operator.evaluate");
+                for (size_t i = 0; i < s.size(); ++i) {
+                    forces[i] = point.coefficients.evaluate(s.bottom[i], s.right[i], s.top[i], s.left[i]);
+                }
+            }
+
+            CSVReader::CSVData result_data;
+            result_data.headers = {"time", "force", "bottom_pressure", "right_pressure",
+                                   "top_pressure", "left_pressure"};
+            result_data.num_rows = s.size();
+            result_data.columns["time"] = s.time;
+            result_data.columns["force"] = forces;
+            result_data.columns["bottom_pressure"] = s.bottom;
+            result_data.columns["right_pressure"] = s.right;
+            result_data.columns["top_pressure"] = s.top;
+            result_data.columns["left_pressure"] = s.left;
+
+            try {
+                std::filesystem::path filename = outputFilename(c, point.mu, point.u);
+                if (write_csv) {
+                    CSVReader().writeCSV(filename.string(), result_data);
+                }
+                if (write_binary) {
+                    ColumnarFile::write(filename.replace_extension(".pdcol").string(), result_data);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "エラー: " << e.what() << std::endl;
+                failed = true;
+            }
+            ++runs_done;
+        }
+    });
+
+    std::cout << "計算したスイープ点数: " << runs_done << std::endl;
+    return success && !failed;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "time_index.hpp"
+
+/**
+ * マニフェストで指定した複数ケースを1プロセスで計算するバッチドライバ
+ *
+ * マニフェストは1行1ケースのテキストファイル（空白区切り、#以降はコメント）:
+ *
+ *     # 入力ディレクトリ  格子点数  幅[m]  高さ[m]  粘度[Pa・s]  速度[m/s]
+ *     case_a  100     0.1  0.13  0.01             1.0
+ *     case_b  100     0.1  0.13  0.005,0.01,0.02  0.5,1.0
+ *     seal    400x40  0.4  0.04  0.01             1.0
+ *
+ * 粘度・速度はカンマ区切りで複数指定でき、その組み合わせをすべて計算する
+ * （パラメータスイープ）。結果は 入力ディレクトリ/results/ に書き出す。
+ *
+ * 格子点数は n（n×n の格子）または NXxNY（x方向×y方向、例: 400x40）で指定する。
+ * 格子（格子点数・幅・高さ）が同じケースは1つの分解と合力オペレータを共有する。
+ * 係数は 1/μ に比例するので粘度スイープは再分解せずスケーリングで処理し、
+ * 速度は合力オペレータの定数項だけを更新する。
+ * 格子ごとの準備の後、スイープ点（ケース・粘度・速度）ごとのオペレータの係数を取り出し、
+ * 時系列の評価と書き出しはスイープ点単位で全スレッドに分ける（1つの格子のスイープも並列になる）。
+ * 各入力ディレクトリのCSVは一度だけ読み込む。
+ * キャッシュディレクトリを指定すると、合力オペレータを格子ごとに保存・再利用する。
+ */
+class BatchRunner {
+public:
+    /**
+     * 1つの計算ケース（スイープ展開前）
+     */
+    struct Case {
+        std::string input_dir;            // 境界圧力CSVのあるディレクトリ
+        int nx;                           // x方向の格子点数
+        int ny;                           // y方向の格子点数
+        double width;                     // 正方形の幅 [m]
+        double height;                    // 正方形の高さ [m]
+        std::vector<double> viscosities;  // 粘度 [Pa・s]
+        std::vector<double> velocities;   // すべり速度 [m/s]
+    };
+
+private:
+    std::vector<Case> cases;
+    int num_threads;         // スレッド数（0以下ならハードウェアのスレッド数）
+    std::string operator_cache_dir;  // 合力オペレータのキャッシュ（空なら使わない）
+    TimeIndex::Interpolation interpolation;  // 各辺の時刻のそろえ方
+    bool use_csv_cache;      // CSVの変換キャッシュ（*.csv.pdcol）を使うかどうか
+    bool write_csv;          // 結果をCSVで書き出すかどうか
+    bool write_binary;       // 結果を列指向バイナリ（.pdcol）で書き出すかどうか
+
+public:
+    /**
+     * コンストラクタ
+     * @param num_threads スレッド数（0以下ならハードウェアのスレッド数）
+     */
+    explicit BatchRunner(int num_threads = 0);
+
+    /**
+     * マニフェストを読み込む（スイープ点の出力ファイルが重複する場合は失敗する）
+     * @param filename マニフェストファイル名（相対パスの入力ディレクトリはこのファイルの位置から解決）
+     * @return 成功したかどうか
+     */
+    bool loadManifest(const std::string& filename);
+
+    /**
+     * ケースを追加する
+     * @param c 計算ケース
+     */
+    void addCase(const Case& c);
+
+    const std::vector<Case>& getCases() const { return cases; }
+
+    /**
+     * 合力オペレータのキャッシュディレクトリを設定する
+     * @param dir ディレクトリ（空ならキャッシュを使わない）
+     */
+    void setOperatorCacheDirectory(const std::string& dir) { operator_cache_dir = dir; }
+
+    /**
+     * 各辺の時刻のそろえ方を設定する（既定は最も近い時刻の値）
+     * @param mode 補間方法（loadEdgePressureSeries に渡す）
+     */
+    void setInterpolation(TimeIndex::Interpolation mode) { interpolation = mode; }
+
+    /**
+     * CSVの変換キャッシュを使うかどうかを設定する（既定は使う）
+     * @param enabled falseなら毎回CSVを解析し、*.csv.pdcol を書き出さない
+     */
+    void setCsvCache(bool enabled) { use_csv_cache = enabled; }
+
+    /**
+     * 結果の形式を設定する（既定はCSVのみ）
+     * @param csv CSV（outputFilename()）で書き出すかどうか
+     * @param binary 列指向バイナリ（拡張子を .pdcol にしたファイル）で書き出すかどうか
+     */
+    void setOutputFormats(bool csv, bool binary) {
+        write_csv = csv;
+        write_binary = binary;
+    }
+
+    /**
+     * すべてのケースを計算して結果を書き出す
+     * @return すべてのケースが成功したかどうか
+     */
+    bool run() const;
+
+    /**
+     * 格子点数の指定を解釈する
+     * @param text "n"（n×n）または "NXxNY"
+     * @param nx x方向の格子点数
+     * @param ny y方向の格子点数
+     * @return 正しい指定（各方向3点以上）かどうか
+     */
+    static bool parseGridSize(const std::string& text, int& nx, int& ny);
+
+    /**
+     * スイープ点ごとの出力ファイル名（粘度・速度は往復で同じ値に戻る最短の表記）
+     * @param c 計算ケース
+     * @param mu 粘度 [Pa・s]
+     * @param u 速度 [m/s]
+     * @return 出力ファイルのパス
+     */
+    static std::string outputFilename(const Case& c, double mu, double u);
+};
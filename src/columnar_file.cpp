@@ -0,0 +1,157 @@
+#include "columnar_file.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'D', 'C', 'O', 'L', '0', '0', '1'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr uint64_t kDataAlignment = 64;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t num_columns;
+    uint64_t num_rows;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t data_offset;
+};
+static_assert(sizeof(FileHeader) == 48, "unexpected header layout");
+
+struct ColumnEntry {
+    uint32_t type;
+    uint32_t name_length;
+};
+
+}
+
+ColumnarFile::ColumnarFile(const std::string& filename)
+    : file(filename), num_rows(0), source_size(0), source_mtime(0) {
+    auto invalid = [&](const std::string& reason) {
+        return std::runtime_error("Invalid columnar file " + filename + ": " + reason);
+    };
+
+    const char* base = file.data();
+    size_t size = file.size();
+    if (size < sizeof(FileHeader)) {
+        throw invalid("too small");
+    }
+
+    FileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        throw invalid("bad magic");
+    }
+    if (header.byte_order != kByteOrderMark) {
+        throw invalid("byte order mismatch");
+    }
+    num_rows = static_cast<size_t>(header.num_rows);
+    source_size = header.source_size;
+    source_mtime = header.source_mtime;
+
+    // 列表（offset ≤ size を保つので、残りの長さ size - offset と比べればあふれない）
+    size_t offset = sizeof(FileHeader);
+    for (uint32_t c = 0; c < header.num_columns; ++c) {
+        ColumnEntry entry;
+        if (sizeof(entry) > size - offset) {
+            throw invalid("truncated column table");
+        }
+        std::memcpy(&entry, base + offset, sizeof(entry));
+        offset += sizeof(entry);
+        if (entry.type != static_cast<uint32_t>(ColumnType::Float64)) {
+            throw invalid("unsupported column type");
+        }
+        if (entry.name_length > size - offset) {
+            throw invalid("truncated column table");
+        }
+        names.emplace_back(base + offset, entry.name_length);
+        offset += entry.name_length;
+    }
+
+    // データ部（行数・列数はファイルの値なので、積や和をとらずに残りの長さと比べる）
+    if (header.data_offset < offset || header.data_offset % alignof(double) != 0 ||
+        header.data_offset > size ||
+        (header.num_columns > 0 &&
+         header.num_rows > (size - header.data_offset) / sizeof(double) / header.num_columns)) {
+        throw invalid("truncated data");
+    }
+    uint64_t column_bytes = header.num_rows * sizeof(double);
+    for (uint32_t c = 0; c < header.num_columns; ++c) {
+        columns.push_back(reinterpret_cast<const double*>(base + header.data_offset + c * column_bytes));
+    }
+}
+
+bool ColumnarFile::hasColumn(const std::string& column_name) const {
+    return std::find(names.begin(), names.end(), column_name) != names.end();
+}
+
+const double* ColumnarFile::column(const std::string& column_name) const {
+    auto it = std::find(names.begin(), names.end(), column_name);
+    if (it == names.end()) {
+        throw std::runtime_error("Column '" + column_name + "' not found");
+    }
+    return columns[it - names.begin()];
+}
+
+CSVReader::CSVData ColumnarFile::toCSVData(const std::vector<std::string>* column_names) const {
+    CSVReader::CSVData data;
+    data.headers = column_names ? *column_names : names;
+    data.num_rows = num_rows;
+    for (const auto& name : data.headers) {
+        const double* values = column(name);
+        data.columns[name].assign(values, values + num_rows);
+    }
+    return data;
+}
+
+void ColumnarFile::write(const std::string& filename, const CSVReader::CSVData& data,
+                         uint64_t source_size, int64_t source_mtime) {
+    PD_TRACE_SCOPE("columnar.write");
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Cannot create file: " + filename);
+    }
+
+    // ヘッダーと列表
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.byte_order = kByteOrderMark;
+    header.num_columns = static_cast<uint32_t>(data.headers.size());
+    header.num_rows = data.num_rows;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+
+    std::string table;
+    for (const auto& name : data.headers) {
+        ColumnEntry entry{static_cast<uint32_t>(ColumnType::Float64), static_cast<uint32_t>(name.size())};
+        table.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        table.append(name);
+    }
+    uint64_t table_end = sizeof(FileHeader) + table.size();
+    header.data_offset = (table_end + kDataAlignment - 1) / kDataAlignment * kDataAlignment;
+    table.append(header.data_offset - table_end, '\0');
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(table.data(), static_cast<std::streamsize>(table.size()));
+
+    // 列データ（行数に満たない列は0で埋める）
+    for (const auto& name : data.headers) {
+        const auto& values = data.getColumn(name);
+        size_t stored = std::min(values.size(), data.num_rows);
+        out.write(reinterpret_cast<const char*>(values.data()),
+                  static_cast<std::streamsize>(stored * sizeof(double)));
+        if (stored < data.num_rows) {
+            std::vector<double> zeros(data.num_rows - stored, 0.0);
+            out.write(reinterpret_cast<const char*>(zeros.data()),
+                      static_cast<std::streamsize>(zeros.size() * sizeof(double)));
+        }
+    }
+
+    if (!out) {
+        throw std::runtime_error("Failed to write file: " + filename);
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "csv_reader.hpp"
+#include "mapped_file.hpp"
+
+/**
+ * 列指向のバイナリファイル（.pdcol）
+ *
+ * 構成（ネイティブのバイト順、先頭の byte_order で確認する）:
+ *   ヘッダー（48バイト）: マジック, バイト順, 列数, 行数, 変換元CSVのサイズと更新時刻,
+ *                         データ部の位置
+ *   列表: 列ごとに 型, 名前の長さ, 名前
+ *   データ部（64バイト境界から）: 列ごとに行数分の値を連続して格納
+ *
+ * 読み込みはファイルをメモリマップし、列は割り当て領域を直接指す（コピーしない）。
+ * 現在の型は倍精度浮動小数点数のみ。
+ */
+class ColumnarFile {
+public:
+    /**
+     * 列の型
+     */
+    enum class ColumnType : uint32_t {
+        Float64 = 1
+    };
+
+private:
+    MappedFile file;
+    size_t num_rows;
+    uint64_t source_size;
+    int64_t source_mtime;
+    std::vector<std::string> names;
+    std::vector<const double*> columns;
+
+public:
+    /**
+     * ファイルを開く（形式が不正な場合は例外を送出）
+     * @param filename ファイル名
+     */
+    explicit ColumnarFile(const std::string& filename);
+
+    size_t rows() const { return num_rows; }
+    const std::vector<std::string>& columnNames() const { return names; }
+
+    /**
+     * 変換元CSVのサイズ（CSVから変換したものでなければ0）
+     */
+    uint64_t sourceSize() const { return source_size; }
+
+    /**
+     * 変換元CSVの更新時刻（CSVから変換したものでなければ0）
+     */
+    int64_t sourceModified() const { return source_mtime; }
+
+    bool hasColumn(const std::string& column_name) const;
+
+    /**
+     * 列の先頭へのポインタ（rows()個の値が連続する、存在しなければ例外を送出）
+     * @param column_name 列名
+     */
+    const double* column(const std::string& column_name) const;
+
+    /**
+     * CSVDataへ展開する
+     * @param column_names 展開する列（nullptrならすべて）
+     * @return CSVデータ
+     */
+    CSVReader::CSVData toCSVData(const std::vector<std::string>* column_names = nullptr) const;
+
+    /**
+     * CSVDataをファイルへ書き込む（失敗した場合は例外を送出）
+     * @param filename ファイル名
+     * @param data 書き込むデータ（headersの順に格納する）
+     * @param source_size 変換元CSVのサイズ
+     * @param source_mtime 変換元CSVの更新時刻
+     */
+    static void write(const std::string& filename, const CSVReader::CSVData& data,
+                      uint64_t source_size = 0, int64_t source_mtime = 0);
+};
@@ -1,144 +1,385 @@
 #include "csv_reader.hpp"
+#include "columnar_file.hpp"
+#include "mapped_file.hpp"
+#include "instrumentation.hpp"
 #include <algorithm>
-#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <filesystem>
+#include <limits>
+#include <random>
+#include <stdexcept>
 
-CSVReader::CSVData CSVReader::readCSV(const std::string& filename) const {
-    CSVData data;
-    std::ifstream file(filename);
-    
-    if (!file.is_open()) {
-        throw std::runtime_error("Cannot open file: " + filename);
+namespace {
+
+// 1フィールドの範囲（引用符と前後の空白を除いたもの）
+struct FieldView {
+    const char* begin;
+    const char* end;
+    bool has_escaped_quote;   // "" を含む（文字列として使う場合は置換が必要）
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// pから1フィールドを読み、区切り文字・改行・終端の位置を返す
+const char* scanField(const char* p, const char* end, char delimiter, FieldView& field) {
+    while (p < end && isBlank(*p) && *p != delimiter) {
+        ++p;
     }
-    
-    std::string line;
-    bool first_line = true;
-    
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
-        
-        std::vector<std::string> tokens = splitLine(line);
-        
-        if (first_line) {
-            // ヘッダー行の処理
-            data.headers = tokens;
-            for (const auto& header : data.headers) {
-                data.columns[header] = std::vector<double>();
+
+    field.has_escaped_quote = false;
+    if (p < end && *p == '"') {
+        // 引用符付きフィールド（区切り文字・改行を含んでよい、"" は " を表す）
+        field.begin = ++p;
+        while (p < end) {
+            if (*p == '"') {
+                if (p + 1 < end && p[1] == '"') {
+                    field.has_escaped_quote = true;
+                    p += 2;
+                    continue;
+                }
+                break;
             }
-            first_line = false;
-        } else {
-            // データ行の処理
-            if (tokens.size() != data.headers.size()) {
-                std::cerr << "Warning: Row has different number of columns than header" << std::endl;
+            ++p;
+        }
+        field.end = p;
+        if (p < end) {
+            ++p;   // 閉じ引用符
+        }
+        // 閉じ引用符の後ろは次の区切りまで読み飛ばす
+        while (p < end && *p != delimiter && *p != '\n') {
+            ++p;
+        }
+        return p;
+    }
+
+    field.begin = p;
+    while (p < end && *p != delimiter && *p != '\n') {
+        ++p;
+    }
+    field.end = p;
+    while (field.end > field.begin && isBlank(field.end[-1])) {
+        --field.end;
+    }
+    return p;
+}
+
+std::string fieldToString(const FieldView& field) {
+    std::string str(field.begin, field.end);
+    if (field.has_escaped_quote) {
+        size_t pos = 0;
+        while ((pos = str.find("\"\"", pos)) != std::string::npos) {
+            str.erase(pos, 1);
+            ++pos;
+        }
+    }
+    return str;
+}
+
+// 数値に変換する（数値でない場合は0）
+double fieldToNumber(const FieldView& field) {
+    const char* first = field.begin;
+    if (first < field.end && *first == '+') {
+        ++first;
+    }
+    double value = 0.0;
+    auto result = std::from_chars(first, field.end, value);
+    if (result.ec != std::errc() || result.ptr != field.end) {
+        return 0.0;
+    }
+    return value;
+}
+
+}
+
+CSVReader::ChunkStream::ChunkStream(const std::string& filename,
+                                    const std::vector<std::string>* column_names,
+                                    char delimiter, size_t chunk_rows)
+    : file(filename), cursor(file.begin()), end(file.end()), delimiter(delimiter),
+      chunk_rows(std::max<size_t>(chunk_rows, 1)), num_fields(0),
+      rows_read(0), skipped_rows(0), filename(filename) {
+    // UTF-8のBOMを読み飛ばす
+    if (end - cursor >= 3 && cursor[0] == '\xEF' && cursor[1] == '\xBB' && cursor[2] == '\xBF') {
+        cursor += 3;
+    }
+
+    // ヘッダー行の処理
+    skipEmptyLines();
+    std::vector<std::string> file_headers;
+    FieldView field;
+    while (cursor < end) {
+        cursor = scanField(cursor, end, delimiter, field);
+        file_headers.push_back(fieldToString(field));
+        if (cursor < end && *cursor == delimiter) {
+            ++cursor;
+            continue;
+        }
+        break;
+    }
+    if (cursor < end) {
+        ++cursor;   // 改行
+    }
+    num_fields = file_headers.size();
+
+    // ファイルの列 → 出力列の対応
+    slot_of_field.assign(num_fields, -1);
+    if (column_names) {
+        headers = *column_names;
+        for (size_t c = 0; c < column_names->size(); ++c) {
+            auto it = std::find(file_headers.begin(), file_headers.end(), (*column_names)[c]);
+            if (it == file_headers.end()) {
+                throw std::runtime_error("Column '" + (*column_names)[c] + "' not found in " + filename);
+            }
+            slot_of_field[it - file_headers.begin()] = static_cast<int>(c);
+        }
+    } else {
+        headers = file_headers;
+        for (size_t c = 0; c < num_fields; ++c) {
+            slot_of_field[c] = static_cast<int>(c);
+        }
+    }
+
+    skipEmptyLines();
+}
+
+void CSVReader::ChunkStream::skipEmptyLines() {
+    while (cursor < end) {
+        const char* q = cursor;
+        while (q < end && isBlank(*q)) {
+            ++q;
+        }
+        if (q < end && *q != '\n') {
+            return;
+        }
+        cursor = (q < end) ? q + 1 : q;
+    }
+}
+
+size_t CSVReader::ChunkStream::estimateRemainingRows() const {
+    if (cursor >= end) {
+        return 0;
+    }
+    const char* row_end = std::find(cursor, end, '\n');
+    size_t row_length = static_cast<size_t>(row_end - cursor) + 1;
+    return static_cast<size_t>(end - cursor) / row_length + 1;
+}
+
+size_t CSVReader::ChunkStream::readRows(std::vector<std::vector<double>*>& slots, size_t max_rows) {
+    std::vector<double> row_values(slots.size());
+    FieldView field;
+    size_t rows = 0;
+    while (cursor < end && rows < max_rows) {
+        size_t field_index = 0;
+        while (true) {
+            cursor = scanField(cursor, end, delimiter, field);
+            if (field_index < num_fields && slot_of_field[field_index] >= 0) {
+                row_values[slot_of_field[field_index]] = fieldToNumber(field);
+            }
+            ++field_index;
+            if (cursor < end && *cursor == delimiter) {
+                ++cursor;
                 continue;
             }
-            
-            for (size_t i = 0; i < tokens.size(); ++i) {
-                if (isNumber(tokens[i])) {
-                    data.columns[data.headers[i]].push_back(parseNumber(tokens[i]));
-                } else {
-                    // 数値でない場合は0として扱う（または例外を投げる）
-                    data.columns[data.headers[i]].push_back(0.0);
+            break;
+        }
+        if (cursor < end) {
+            ++cursor;   // 改行
+        }
+
+        if (field_index != num_fields) {
+            ++skipped_rows;
+        } else {
+            for (size_t c = 0; c < slots.size(); ++c) {
+                slots[c]->push_back(row_values[c]);
+            }
+            ++rows;
+        }
+        skipEmptyLines();
+    }
+
+    rows_read += rows;
+    if (cursor >= end && skipped_rows > 0) {
+        std::cerr << "Warning: " << skipped_rows << " row(s) in " << filename
+                  << " have a different number of columns than the header" << std::endl;
+        skipped_rows = 0;
+    }
+    return rows;
+}
+
+bool CSVReader::ChunkStream::next(Chunk& chunk) {
+    PD_TRACE_SCOPE("csv.parse_chunk");
+    chunk.headers = headers;
+    chunk.columns.resize(headers.size());
+    std::vector<std::vector<double>*> slots;
+    for (auto& column : chunk.columns) {
+        column.clear();
+        column.reserve(chunk_rows);
+        slots.push_back(&column);
+    }
+
+    chunk.first_row = rows_read;
+    chunk.num_rows = readRows(slots, chunk_rows);
+
+    // 読み終えた領域のページを解放する
+    file.releaseBefore(cursor);
+    return chunk.num_rows > 0;
+}
+
+CSVReader::ChunkStream CSVReader::openStream(const std::string& filename,
+                                             const std::vector<std::string>& column_names,
+                                             size_t chunk_rows) const {
+    return ChunkStream(filename, &column_names, delimiter, chunk_rows);
+}
+
+CSVReader::CSVData CSVReader::readCSV(const std::string& filename) const {
+    return parse(filename, nullptr);
+}
+
+CSVReader::CSVData CSVReader::readCSV(const std::string& filename,
+                                      const std::vector<std::string>& column_names) const {
+    return parse(filename, &column_names);
+}
+
+CSVReader::CSVData CSVReader::parse(const std::string& filename,
+                                    const std::vector<std::string>* column_names) const {
+    PD_TRACE_SCOPE("csv.parse");
+    ChunkStream stream(filename, column_names, delimiter, 1);
+
+    CSVData data;
+    data.headers = stream.getHeaders();
+
+    // 列のベクトルを直接参照できるようにし、最初のデータ行の長さから行数を見積もって事前確保
+    size_t estimated_rows = stream.estimateRemainingRows();
+    std::vector<std::vector<double>*> slots;
+    for (const auto& header : data.headers) {
+        auto& column = data.columns[header];
+        column.reserve(estimated_rows);
+        slots.push_back(&column);
+    }
+
+    data.num_rows = stream.readRows(slots, std::numeric_limits<size_t>::max());
+    PD_TRACE_COUNT("csv.rows", data.num_rows);
+    return data;
+}
+
+CSVReader::CSVData CSVReader::readCSVCached(const std::string& filename,
+                                            const std::vector<std::string>& column_names) const {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    uint64_t source_size = fs::file_size(filename, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+    int64_t source_mtime = static_cast<int64_t>(fs::last_write_time(filename, ec).time_since_epoch().count());
+
+    // キャッシュが最新で必要な列をすべて含んでいればそれを使う
+    std::string cache_file = cacheFilename(filename);
+    std::vector<std::string> cached_columns;
+    if (fs::exists(cache_file, ec)) {
+        try {
+            ColumnarFile cache(cache_file);
+            if (cache.sourceSize() == source_size && cache.sourceModified() == source_mtime) {
+                bool complete = std::all_of(column_names.begin(), column_names.end(),
+                                            [&](const std::string& name) { return cache.hasColumn(name); });
+                if (complete) {
+                    return cache.toCSVData(&column_names);
                 }
+                cached_columns = cache.columnNames();
             }
-            data.num_rows++;
+        } catch (const std::exception&) {
+            // 壊れたキャッシュは作り直す
         }
     }
-    
-    file.close();
+
+    // CSVを解析してキャッシュを作り直す（以前の列も残す）
+    std::vector<std::string> parse_columns = cached_columns;
+    for (const auto& name : column_names) {
+        if (std::find(parse_columns.begin(), parse_columns.end(), name) == parse_columns.end()) {
+            parse_columns.push_back(name);
+        }
+    }
+    CSVData parsed = readCSV(filename, parse_columns);
+
+    // 別のプロセスと競合しないよう一時ファイルに書いてから置き換える
+    std::string temp_file = cache_file + ".tmp" + std::to_string(std::random_device()());
+    try {
+        ColumnarFile::write(temp_file, parsed, source_size, source_mtime);
+        fs::rename(temp_file, cache_file);
+    } catch (const std::exception& e) {
+        fs::remove(temp_file, ec);
+        std::cerr << "Warning: cannot write cache " << cache_file << ": " << e.what() << std::endl;
+    }
+
+    if (parse_columns.size() == column_names.size()) {
+        return parsed;
+    }
+    CSVData data;
+    data.headers = column_names;
+    data.num_rows = parsed.num_rows;
+    for (const auto& name : column_names) {
+        data.columns[name] = std::move(parsed.columns[name]);
+    }
     return data;
 }
 
+std::string CSVReader::cacheFilename(const std::string& filename) {
+    return filename + ".pdcol";
+}
+
+void CSVReader::appendNumber(std::string& out, double value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
 void CSVReader::writeCSV(const std::string& filename, const CSVData& data) const {
-    std::ofstream file(filename);
+    PD_TRACE_SCOPE("output.write_csv");
+    std::ofstream file(filename, std::ios::binary);
     
     if (!file.is_open()) {
         throw std::runtime_error("Cannot create file: " + filename);
     }
     
     // ヘッダーを書き込み
+    std::string buffer;
     for (size_t i = 0; i < data.headers.size(); ++i) {
-        file << data.headers[i];
+        buffer += data.headers[i];
         if (i < data.headers.size() - 1) {
-            file << delimiter;
+            buffer += delimiter;
         }
     }
-    file << std::endl;
+    buffer += '\n';
+    
+    // 列を事前に引いておく
+    std::vector<const std::vector<double>*> columns;
+    for (const auto& header : data.headers) {
+        columns.push_back(&data.columns.at(header));
+    }
     
-    // データを書き込み
+    // データを書き込み（一定量たまるごとに出力）
+    constexpr size_t flush_size = 1 << 20;
     for (size_t row = 0; row < data.num_rows; ++row) {
-        for (size_t col = 0; col < data.headers.size(); ++col) {
-            const auto& column = data.columns.at(data.headers[col]);
+        for (size_t col = 0; col < columns.size(); ++col) {
+            const auto& column = *columns[col];
             if (row < column.size()) {
-                file << column[row];
+                appendNumber(buffer, column[row]);
             }
-            if (col < data.headers.size() - 1) {
-                file << delimiter;
+            if (col < columns.size() - 1) {
+                buffer += delimiter;
             }
         }
-        file << std::endl;
-    }
-    
-    file.close();
-}
-
-std::vector<std::string> CSVReader::splitLine(const std::string& line) const {
-    std::vector<std::string> tokens;
-    std::stringstream ss(line);
-    std::string token;
-    
-    while (std::getline(ss, token, delimiter)) {
-        // 前後の空白を削除
-        token.erase(token.begin(), std::find_if(token.begin(), token.end(), [](unsigned char ch) {
-            return !std::isspace(ch);
-        }));
-        token.erase(std::find_if(token.rbegin(), token.rend(), [](unsigned char ch) {
-            return !std::isspace(ch);
-        }).base(), token.end());
+        buffer += '\n';
         
-        tokens.push_back(token);
-    }
-    
-    return tokens;
-}
-
-bool CSVReader::isNumber(const std::string& str) const {
-    if (str.empty()) return false;
-    
-    size_t start = 0;
-    if (str[0] == '-' || str[0] == '+') {
-        start = 1;
-    }
-    
-    bool has_decimal = false;
-    bool has_digit = false;
-    
-    for (size_t i = start; i < str.length(); ++i) {
-        if (std::isdigit(str[i])) {
-            has_digit = true;
-        } else if (str[i] == '.' && !has_decimal) {
-            has_decimal = true;
-        } else if (str[i] == 'e' || str[i] == 'E') {
-            // 科学的記法をサポート
-            if (i == str.length() - 1) return false;
-            i++;
-            if (str[i] == '+' || str[i] == '-') i++;
-            if (i >= str.length()) return false;
-            for (; i < str.length(); ++i) {
-                if (!std::isdigit(str[i])) return false;
-            }
-            break;
-        } else {
-            return false;
+        if (buffer.size() >= flush_size) {
+            file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            buffer.clear();
         }
     }
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
     
-    return has_digit;
-}
-
-double CSVReader::parseNumber(const std::string& str) const {
-    try {
-        return std::stod(str);
-    } catch (const std::exception&) {
-        return 0.0;
+    if (!file) {
+        throw std::runtime_error("Failed to write file: " + filename);
     }
-}
\ No newline at end of file
+}
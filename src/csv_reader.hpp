@@ -1,3 +1,5 @@
+#pragma once
+
 #include <string>
 #include <vector>
 #include <map>
@@ -5,6 +7,10 @@
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+#include "mapped_file.hpp"
+#include "time_index.hpp"
 
 class CSVReader {
 public:
@@ -29,13 +35,15 @@ public:
             return columns.find(column_name) != columns.end();
         }
         
-        // ユニークな値を取得
+        // ユニークな値を取得（最初に現れた順）
         std::vector<double> getUniqueValues(const std::string& column_name) const {
             const auto& col = getColumn(column_name);
             std::vector<double> unique_vals;
+            std::unordered_set<double> seen;
+            seen.reserve(col.size());
             
             for (double val : col) {
-                if (std::find(unique_vals.begin(), unique_vals.end(), val) == unique_vals.end()) {
+                if (seen.insert(val).second) {
                     unique_vals.push_back(val);
                 }
             }
@@ -43,7 +51,12 @@ public:
             return unique_vals;
         }
         
-        // 最も近い時間のインデックスを取得
+        // 時刻列の索引を構築（多数の時刻を検索する場合に使う）
+        TimeIndex buildTimeIndex(const std::string& time_column) const {
+            return TimeIndex(getColumn(time_column));
+        }
+        
+        // 最も近い時間のインデックスを取得（1回ごとに全行を走査する）
         size_t findClosestTimeIndex(const std::string& time_column, double target_time) const {
             const auto& time_col = getColumn(time_column);
             size_t best_idx = 0;
@@ -61,6 +74,76 @@ public:
         }
     };
 
+    /**
+     * ストリームから読み出した一定行数分の列データ
+     */
+    struct Chunk {
+        std::vector<std::string> headers;
+        std::vector<std::vector<double>> columns;   // headersと同じ順
+        size_t num_rows;
+        size_t first_row;                           // 先頭行のデータ行番号（0始まり）
+        
+        Chunk() : num_rows(0), first_row(0) {}
+        
+        // 特定の列のデータを取得
+        const std::vector<double>& getColumn(const std::string& column_name) const {
+            auto it = std::find(headers.begin(), headers.end(), column_name);
+            if (it == headers.end()) {
+                throw std::runtime_error("Column '" + column_name + "' not found");
+            }
+            return columns[it - headers.begin()];
+        }
+    };
+
+    /**
+     * 指定した列を一定行数ずつ読み出すストリーム
+     *
+     * ファイル全体を保持せずに先頭から順に処理できる。読み終えた領域の
+     * ページは解放するので、常駐メモリはチャンクの大きさ程度に抑えられる。
+     */
+    class ChunkStream {
+    private:
+        MappedFile file;
+        const char* cursor;
+        const char* end;
+        char delimiter;
+        size_t chunk_rows;
+        size_t num_fields;                    // ヘッダーの列数
+        std::vector<int> slot_of_field;       // ファイルの列 → 出力列（-1は読み飛ばす）
+        std::vector<std::string> headers;     // 出力する列名
+        size_t rows_read;
+        size_t skipped_rows;
+        std::string filename;
+
+    public:
+        ChunkStream(const std::string& filename, const std::vector<std::string>* column_names,
+                    char delimiter, size_t chunk_rows);
+        
+        /**
+         * 次のチャンクを読み出す
+         * @param chunk 読み出し先（列ベクトルの領域は再利用される）
+         * @return 1行以上読めたかどうか（終端ならfalse）
+         */
+        bool next(Chunk& chunk);
+        
+        const std::vector<std::string>& getHeaders() const { return headers; }
+        
+        /**
+         * 残りのデータ行数の見積もり（次の行の長さから推定）
+         */
+        size_t estimateRemainingRows() const;
+        
+        /**
+         * 列数がヘッダーと一致せず読み飛ばした行数
+         */
+        size_t getSkippedRows() const { return skipped_rows; }
+        
+    private:
+        friend class CSVReader;
+        size_t readRows(std::vector<std::vector<double>*>& slots, size_t max_rows);
+        void skipEmptyLines();
+    };
+
 private:
     char delimiter;
 
@@ -69,20 +152,71 @@ public:
 
     /**
      * CSVファイルを読み込む
+     *
+     * ファイルをメモリマップし、行・フィールドを文字列にコピーせずに走査する。
+     * 引用符で囲まれたフィールド（区切り文字や "" を含んでよい）に対応し、
+     * 数値は std::from_chars で変換する。数値でないフィールドは0として扱う。
      * @param filename ファイル名
      * @return CSVデータ
      */
     CSVData readCSV(const std::string& filename) const;
 
+    /**
+     * 指定した列だけを読み込む
+     *
+     * 指定外の列は区切り位置を探すだけで変換しない。大きなファイルから
+     * simulation_time や pressure_ave だけを取り出す用途向け。
+     * @param filename ファイル名
+     * @param column_names 読み込む列名（存在しない列があれば例外を送出）
+     * @return 指定した列のみを含むCSVデータ（headersは指定した順）
+     */
+    CSVData readCSV(const std::string& filename, const std::vector<std::string>& column_names) const;
+
+    /**
+     * 変換キャッシュを使って指定した列を読み込む
+     *
+     * 初回はCSVを解析して列指向バイナリ（filename + ".pdcol"）に保存し、
+     * 2回目以降は変換元のサイズと更新時刻が一致すればキャッシュから読み込む。
+     * キャッシュにない列を要求した場合は既存の列と合わせて作り直す。
+     * キャッシュを書けない場合（読み取り専用など）はCSVの解析結果をそのまま返す。
+     * @param filename ファイル名
+     * @param column_names 読み込む列名（存在しない列があれば例外を送出）
+     * @return 指定した列のみを含むCSVデータ（headersは指定した順）
+     */
+    CSVData readCSVCached(const std::string& filename, const std::vector<std::string>& column_names) const;
+
+    /**
+     * 変換キャッシュのファイル名
+     * @param filename CSVファイル名
+     */
+    static std::string cacheFilename(const std::string& filename);
+
+    /**
+     * 指定した列をチャンク単位で読み出すストリームを開く
+     * @param filename ファイル名
+     * @param column_names 読み込む列名（存在しない列があれば例外を送出）
+     * @param chunk_rows 1チャンクの行数
+     * @return ストリーム
+     */
+    ChunkStream openStream(const std::string& filename, const std::vector<std::string>& column_names,
+                           size_t chunk_rows = 65536) const;
+
     /**
      * CSVデータを書き込む
+     *
+     * 数値は読み戻すと同じ値になる最短の10進表現で書き、まとめて出力する。
      * @param filename ファイル名
      * @param data 書き込むデータ
      */
     void writeCSV(const std::string& filename, const CSVData& data) const;
 
+    /**
+     * 数値を読み戻すと同じ値になる最短の10進表現で追記する
+     * @param out 追記先
+     * @param value 値
+     */
+    static void appendNumber(std::string& out, double value);
+
 private:
-    std::vector<std::string> splitLine(const std::string& line) const;
-    bool isNumber(const std::string& str) const;
-    double parseNumber(const std::string& str) const;
+    CSVData parse(const std::string& filename, const std::vector<std::string>* column_names) const;
 };
\ No newline at end of file
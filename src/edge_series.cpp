@@ -0,0 +1,217 @@
+#include "edge_series.hpp"
+#include "csv_reader.hpp"
+#include "instrumentation.hpp"
+#include <cmath>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+
+namespace {
+
+const std::vector<std::string> kEdgeColumns = {"simulation_time", "pressure_ave"};
+
+// 時刻昇順の1辺の圧力を先頭から順に読み、指定時刻の値を返すカーソル
+class TimeCursor {
+private:
+    CSVReader::ChunkStream stream;
+    CSVReader::Chunk chunk;
+    size_t pos;            // chunk内の次に読む行
+    bool has_current;
+    double current_time;
+    double current_pressure;
+    std::string filename;
+
+public:
+    TimeCursor(const std::string& filename, size_t chunk_rows)
+        : stream(CSVReader().openStream(filename, kEdgeColumns, chunk_rows)),
+          pos(0), has_current(false), current_time(0.0), current_pressure(0.0),
+          filename(filename) {}
+
+    // 時刻tの値（tは単調増加で呼ぶこと、範囲外は端の値）
+    double valueAt(double t, TimeIndex::Interpolation mode) {
+        double next_time, next_pressure;
+        if (!has_current) {
+            if (!peek(next_time, next_pressure)) {
+                throw std::runtime_error("No data rows in " + filename);
+            }
+            advance(next_time, next_pressure);
+        }
+
+        while (peek(next_time, next_pressure)) {
+            bool move = (mode == TimeIndex::Interpolation::Nearest)
+                ? std::abs(next_time - t) < std::abs(current_time - t)   // 等距離なら先の行
+                : next_time <= t;
+            if (!move) {
+                break;
+            }
+            advance(next_time, next_pressure);
+        }
+
+        if (mode == TimeIndex::Interpolation::Linear && t > current_time &&
+            peek(next_time, next_pressure)) {
+            double w = (t - current_time) / (next_time - current_time);
+            return (1.0 - w) * current_pressure + w * next_pressure;
+        }
+        return current_pressure;
+    }
+
+private:
+    // 次の異なる時刻の行（同じ時刻の行は最初の行のみ使う）
+    bool peek(double& t, double& p) {
+        while (true) {
+            if (pos >= chunk.num_rows) {
+                if (!stream.next(chunk)) {
+                    return false;
+                }
+                pos = 0;
+            }
+            t = chunk.columns[0][pos];
+            p = chunk.columns[1][pos];
+            if (has_current && t == current_time) {
+                ++pos;
+                continue;
+            }
+            return true;
+        }
+    }
+
+    void advance(double t, double p) {
+        if (has_current && t < current_time) {
+            throw std::runtime_error("simulation_time is not sorted in " + filename);
+        }
+        has_current = true;
+        current_time = t;
+        current_pressure = p;
+        ++pos;
+    }
+};
+
+// 下辺の時刻を基準に4辺をそろえて読み進める
+class EdgeSeriesStream {
+private:
+    CSVReader::ChunkStream bottom;
+    TimeCursor right;
+    TimeCursor top;
+    TimeCursor left;
+    CSVReader::Chunk chunk;
+    size_t pos;
+    size_t chunk_rows;
+    TimeIndex::Interpolation mode;
+    bool has_last;
+    double last_time;
+    std::string bottom_file;
+
+public:
+    EdgeSeriesStream(const std::filesystem::path& dir, size_t chunk_rows, TimeIndex::Interpolation mode)
+        : bottom(CSVReader().openStream((dir / "bottompressure.csv").string(), kEdgeColumns, chunk_rows)),
+          right((dir / "rightpressure.csv").string(), chunk_rows),
+          top((dir / "toppressure.csv").string(), chunk_rows),
+          left((dir / "leftpressure.csv").string(), chunk_rows),
+          pos(0), chunk_rows(std::max<size_t>(chunk_rows, 1)), mode(mode), has_last(false), last_time(0.0),
+          bottom_file((dir / "bottompressure.csv").string()) {}
+
+    // 次のチャンクを読む（終端ならfalse）
+    bool read(EdgePressureSeries& series) {
+        PD_TRACE_SCOPE("series.read_chunk");
+        series.time.clear();
+        series.bottom.clear();
+        series.right.clear();
+        series.top.clear();
+        series.left.clear();
+
+        while (series.size() < chunk_rows) {
+            if (pos >= chunk.num_rows) {
+                if (!bottom.next(chunk)) {
+                    break;
+                }
+                pos = 0;
+            }
+            double t = chunk.columns[0][pos];
+            double p = chunk.columns[1][pos];
+            ++pos;
+
+            // 重複する時刻は最初の行のみ使う（getUniqueValuesと同じ）
+            if (has_last && t <= last_time) {
+                if (t < last_time) {
+                    throw std::runtime_error("simulation_time is not sorted in " + bottom_file);
+                }
+                continue;
+            }
+            has_last = true;
+            last_time = t;
+
+            series.time.push_back(t);
+            series.bottom.push_back(p);
+            series.right.push_back(right.valueAt(t, mode));
+            series.top.push_back(top.valueAt(t, mode));
+            series.left.push_back(left.valueAt(t, mode));
+        }
+        return series.size() > 0;
+    }
+};
+
+}
+
+EdgePressureSeries alignEdgeSeries(const CSVReader::CSVData& bottom,
+                                   const CSVReader::CSVData& right,
+                                   const CSVReader::CSVData& top,
+                                   const CSVReader::CSVData& left,
+                                   TimeIndex::Interpolation mode) {
+    PD_TRACE_SCOPE("series.align");
+    // 共通の時間値を取得（bottompressureファイルから）
+    EdgePressureSeries series;
+    series.time = bottom.getUniqueValues("simulation_time");
+
+    // 各辺の時刻索引を一度だけ構築し、共通の時刻へ再標本化する
+    auto resampleEdge = [&](const CSVReader::CSVData& data) {
+        TimeIndex index = data.buildTimeIndex("simulation_time");
+        return index.resample(data.getColumn("pressure_ave"), series.time, mode);
+    };
+    series.bottom = resampleEdge(bottom);
+    series.right = resampleEdge(right);
+    series.top = resampleEdge(top);
+    series.left = resampleEdge(left);
+
+    return series;
+}
+
+EdgePressureSeries loadEdgePressureSeries(const std::string& directory,
+                                          TimeIndex::Interpolation mode,
+                                          bool use_cache) {
+    PD_TRACE_SCOPE("series.load");
+    std::filesystem::path dir(directory);
+    CSVReader reader;
+
+    // 必要な2列だけを読み込む
+    auto read = [&](const char* name) {
+        std::string filename = (dir / name).string();
+        return use_cache ? reader.readCSVCached(filename, kEdgeColumns)
+                         : reader.readCSV(filename, kEdgeColumns);
+    };
+    auto bottom_pressure = read("bottompressure.csv");
+    auto left_pressure = read("leftpressure.csv");
+    auto right_pressure = read("rightpressure.csv");
+    auto top_pressure = read("toppressure.csv");
+
+    return alignEdgeSeries(bottom_pressure, right_pressure, top_pressure, left_pressure, mode);
+}
+
+bool streamEdgePressureSeries(const std::string& directory, size_t chunk_rows,
+                              const std::function<bool(const EdgePressureSeries&)>& consumer,
+                              TimeIndex::Interpolation mode) {
+    EdgeSeriesStream stream(std::filesystem::path(directory), chunk_rows, mode);
+
+    // 現在のチャンクを処理している間に次のチャンクを読み込む
+    EdgePressureSeries current, next;
+    bool has_chunk = stream.read(current);
+    while (has_chunk) {
+        auto pending = std::async(std::launch::async, [&]() { return stream.read(next); });
+        bool keep_going = consumer(current);
+        has_chunk = pending.get();
+        if (!keep_going) {
+            return false;
+        }
+        std::swap(current, next);
+    }
+    return true;
+}
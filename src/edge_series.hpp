@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "csv_reader.hpp"
+#include "time_index.hpp"
+
+/**
+ * 4辺の平均圧力の時系列
+ */
+struct EdgePressureSeries {
+    std::vector<double> time;     // 時刻 [s]
+    std::vector<double> bottom;   // 下辺の圧力 [Pa]
+    std::vector<double> right;    // 右辺の圧力 [Pa]
+    std::vector<double> top;      // 上辺の圧力 [Pa]
+    std::vector<double> left;     // 左辺の圧力 [Pa]
+
+    size_t size() const { return time.size(); }
+};
+
+/**
+ * 4辺の圧力データを共通の時刻へそろえる
+ *
+ * 下辺の simulation_time（重複を除き、現れた順）を共通の時刻とし、各辺の
+ * pressure_ave をその時刻へ再標本化する。各辺の時刻は一度だけソートして
+ * 索引を作り、各時刻は二分探索で引くので全体で O(N log N)。
+ * @param bottom 下辺のデータ
+ * @param right 右辺のデータ
+ * @param top 上辺のデータ
+ * @param left 左辺のデータ
+ * @param mode 補間方法
+ * @return 境界圧力の時系列
+ */
+EdgePressureSeries alignEdgeSeries(const CSVReader::CSVData& bottom,
+                                   const CSVReader::CSVData& right,
+                                   const CSVReader::CSVData& top,
+                                   const CSVReader::CSVData& left,
+                                   TimeIndex::Interpolation mode);
+
+/**
+ * ディレクトリ内の4つの境界圧力CSVを読み込み、時刻をそろえた時系列にする
+ *
+ * 時刻のそろえ方は alignEdgeSeries を参照。
+ * @param directory CSVファイルのあるディレクトリ
+ * @param mode 補間方法（既定は最も近い時刻の値）
+ * @param use_cache 列指向バイナリの変換キャッシュを使うかどうか（CSVReader::readCSVCached）
+ * @return 境界圧力の時系列（読み込みに失敗した場合は例外を送出）
+ */
+EdgePressureSeries loadEdgePressureSeries(const std::string& directory,
+                                          TimeIndex::Interpolation mode = TimeIndex::Interpolation::Nearest,
+                                          bool use_cache = true);
+
+/**
+ * 4つの境界圧力CSVをチャンク単位で読み込み、時刻をそろえた時系列を順に渡す
+ *
+ * ファイル全体を読み込まないので、メモリ使用量はチャンクの大きさ程度に抑えられる。
+ * 次のチャンクの読み込みは渡したチャンクの処理と並行して行う。
+ * 各ファイルの時刻は昇順であること（そうでなければ例外を送出）。
+ * 時刻の対応付けは loadEdgePressureSeries と同じで、各辺を1回走査するマージで行う。
+ * @param directory CSVファイルのあるディレクトリ
+ * @param chunk_rows 1チャンクの時間ステップ数
+ * @param consumer 各チャンクを受け取る処理（falseを返すと中断する）
+ * @param mode 補間方法（既定は最も近い時刻の値）
+ * @return 最後まで処理したかどうか（consumerが中断した場合はfalse）
+ */
+bool streamEdgePressureSeries(const std::string& directory, size_t chunk_rows,
+                              const std::function<bool(const EdgePressureSeries&)>& consumer,
+                              TimeIndex::Interpolation mode = TimeIndex::Interpolation::Nearest);
@@ -0,0 +1,369 @@
+#include "field_writer.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+constexpr char kMagic[8] = {'P', 'D', 'F', 'L', 'D', '0', '0', '1'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+constexpr uint32_t kFlagFloat32 = 1u << 0;
+constexpr uint32_t kFlagDelta = 1u << 1;
+constexpr uint32_t kFrameKeyframe = 1u << 0;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t flags;
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t keyframe_interval;
+    uint32_t reserved;
+};
+static_assert(sizeof(FileHeader) == 32, "unexpected header layout");
+
+struct FrameHeader {
+    uint64_t step;
+    double time;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t payload_size;
+};
+static_assert(sizeof(FrameHeader) == 32, "unexpected frame header layout");
+
+// 間引き後の節点番号（stride ごとと最後の節点）
+std::vector<int> decimatedIndices(int count, int stride) {
+    std::vector<int> indices;
+    for (int i = 0; i < count; i += stride) {
+        indices.push_back(i);
+    }
+    if (indices.back() != count - 1) {
+        indices.push_back(count - 1);
+    }
+    return indices;
+}
+
+// 値をビット列に変換する
+uint64_t toBits(double value, bool float32) {
+    if (float32) {
+        float f = static_cast<float>(value);
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double fromBits(uint64_t bits, bool float32) {
+    if (float32) {
+        uint32_t b = static_cast<uint32_t>(bits);
+        float f;
+        std::memcpy(&f, &b, sizeof(f));
+        return f;
+    }
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+// ゼロバイトの連長圧縮
+// 制御バイト c < 128 なら続く c+1 バイトはそのまま、c >= 128 なら c-127 個のゼロ
+void encodeZeroRuns(const std::vector<uint8_t>& in, std::vector<uint8_t>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < in.size()) {
+        if (in[i] == 0) {
+            size_t run = 1;
+            while (i + run < in.size() && in[i + run] == 0 && run < 128) {
+                ++run;
+            }
+            out.push_back(static_cast<uint8_t>(127 + run));
+            i += run;
+        } else {
+            size_t start = i;
+            // 2個以上続くゼロの手前までをそのまま書く
+            while (i < in.size() && i - start < 128 &&
+                   !(in[i] == 0 && i + 1 < in.size() && in[i + 1] == 0)) {
+                ++i;
+            }
+            out.push_back(static_cast<uint8_t>(i - start - 1));
+            out.insert(out.end(), in.begin() + start, in.begin() + i);
+        }
+    }
+}
+
+bool decodeZeroRuns(const std::vector<uint8_t>& in, std::vector<uint8_t>& out, size_t expected) {
+    out.clear();
+    out.reserve(expected);
+    size_t i = 0;
+    while (i < in.size()) {
+        uint8_t c = in[i++];
+        if (c >= 128) {
+            out.insert(out.end(), c - 127, 0);
+        } else {
+            size_t length = static_cast<size_t>(c) + 1;
+            if (i + length > in.size()) {
+                return false;
+            }
+            out.insert(out.end(), in.begin() + i, in.begin() + i + length);
+            i += length;
+        }
+    }
+    return out.size() == expected;
+}
+
+}
+
+FieldWriter::FieldWriter()
+    : closing(false), failed(false), steps_pushed(0), frames_written(0),
+      raw_bytes(0), bytes_written(0) {}
+
+FieldWriter::~FieldWriter() {
+    close();
+}
+
+bool FieldWriter::open(const std::string& filename, const Vector& x, const Vector& y,
+                       const Options& options) {
+    if (file.is_open()) {
+        close();
+    }
+    if (x.size() < 1 || y.size() < 1 || options.spatial_stride < 1 || options.temporal_stride < 1) {
+        std::cerr << "圧力分布の出力設定が不正です" << std::endl;
+        return false;
+    }
+
+    this->options = options;
+    this->options.keyframe_interval = std::max(options.keyframe_interval, 1);
+    this->options.queue_capacity = std::max<size_t>(options.queue_capacity, 1);
+    this->filename = filename;
+    col_index = decimatedIndices(static_cast<int>(x.size()), options.spatial_stride);
+    row_index = decimatedIndices(static_cast<int>(y.size()), options.spatial_stride);
+
+    file.open(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "圧力分布の出力ファイルを作成できません: " << filename << std::endl;
+        return false;
+    }
+
+    std::vector<double> x_out, y_out;
+    for (int j : col_index) x_out.push_back(x(j));
+    for (int i : row_index) y_out.push_back(y(i));
+
+    closing = false;
+    failed = false;
+    steps_pushed = 0;
+    frames_written = 0;
+    raw_bytes = 0;
+    bytes_written = 0;
+    worker = std::thread(&FieldWriter::writerLoop, this, std::move(x_out), std::move(y_out));
+    return true;
+}
+
+bool FieldWriter::push(double time, const Matrix& field) {
+    if (!file.is_open() || failed) {
+        return false;
+    }
+
+    PD_TRACE_SCOPE("output.field_push");
+    uint64_t step = steps_pushed++;
+    raw_bytes += static_cast<uint64_t>(field.size()) * sizeof(double);
+    if (step % static_cast<uint64_t>(options.temporal_stride) != 0) {
+        return true;
+    }
+
+    // 間引きは呼び出し側で行い、キューには必要な値だけを積む
+    Frame frame;
+    frame.step = step;
+    frame.time = time;
+    frame.values.reserve(row_index.size() * col_index.size());
+    for (int i : row_index) {
+        for (int j : col_index) {
+            frame.values.push_back(field(i, j));
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    queue_not_full.wait(lock, [&]() { return queue.size() < options.queue_capacity || failed; });
+    if (failed) {
+        return false;
+    }
+    queue.push_back(std::move(frame));
+    lock.unlock();
+    queue_not_empty.notify_one();
+    return true;
+}
+
+bool FieldWriter::close() {
+    if (!file.is_open()) {
+        return !failed;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    queue_not_empty.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+
+    file.close();
+    if (failed) {
+        std::cerr << "圧力分布の書き込みに失敗しました: " << filename << std::endl;
+    }
+    return !failed;
+}
+
+double FieldWriter::compressionRatio() const {
+    return raw_bytes > 0 ? static_cast<double>(bytes_written) / static_cast<double>(raw_bytes) : 0.0;
+}
+
+void FieldWriter::writerLoop(std::vector<double> x_out, std::vector<double> y_out) {
+    bool float32 = options.quantize_float32;
+    size_t width = float32 ? sizeof(float) : sizeof(double);
+    size_t count = x_out.size() * y_out.size();
+
+    auto write = [&](const void* data, size_t size) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+        bytes_written += size;
+        if (!file) {
+            failed = true;
+        }
+    };
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.byte_order = kByteOrderMark;
+    header.flags = (float32 ? kFlagFloat32 : 0) | (options.delta_encoding ? kFlagDelta : 0);
+    header.cols = static_cast<uint32_t>(x_out.size());
+    header.rows = static_cast<uint32_t>(y_out.size());
+    header.keyframe_interval = static_cast<uint32_t>(options.keyframe_interval);
+    header.reserved = 0;
+    write(&header, sizeof(header));
+    write(x_out.data(), x_out.size() * sizeof(double));
+    write(y_out.data(), y_out.size() * sizeof(double));
+
+    std::vector<uint64_t> previous(count, 0);
+    std::vector<uint8_t> shuffled(count * width);
+    std::vector<uint8_t> payload;
+    uint64_t frame_number = 0;
+
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queue_not_empty.wait(lock, [&]() { return !queue.empty() || closing; });
+            if (queue.empty()) {
+                break;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        queue_not_full.notify_one();
+        if (failed) {
+            continue;
+        }
+        PD_TRACE_SCOPE("output.field_encode");
+
+        bool keyframe = !options.delta_encoding ||
+                        frame_number % static_cast<uint64_t>(options.keyframe_interval) == 0;
+
+        // 量子化・前フレームとのXOR・バイト面への並べ替え
+        for (size_t k = 0; k < count; ++k) {
+            uint64_t bits = toBits(frame.values[k], float32);
+            uint64_t coded = keyframe ? bits : (bits ^ previous[k]);
+            previous[k] = bits;
+            for (size_t b = 0; b < width; ++b) {
+                shuffled[b * count + k] = static_cast<uint8_t>(coded >> (8 * b));
+            }
+        }
+        encodeZeroRuns(shuffled, payload);
+
+        FrameHeader frame_header;
+        frame_header.step = frame.step;
+        frame_header.time = frame.time;
+        frame_header.flags = keyframe ? kFrameKeyframe : 0;
+        frame_header.reserved = 0;
+        frame_header.payload_size = payload.size();
+        write(&frame_header, sizeof(frame_header));
+        write(payload.data(), payload.size());
+
+        ++frame_number;
+        ++frames_written;
+    }
+
+    file.flush();
+    if (!file) {
+        failed = true;
+    }
+    queue_not_full.notify_all();
+}
+
+FieldReader::FieldReader() : flags(0), num_cols(0), num_rows(0) {}
+
+bool FieldReader::open(const std::string& filename) {
+    file.open(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "圧力分布ファイルを開けません: " << filename << std::endl;
+        return false;
+    }
+
+    FileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.byte_order != kByteOrderMark) {
+        std::cerr << "圧力分布ファイルの形式が不正です: " << filename << std::endl;
+        return false;
+    }
+
+    flags = header.flags;
+    num_cols = static_cast<int>(header.cols);
+    num_rows = static_cast<int>(header.rows);
+    x_coords.resize(num_cols);
+    y_coords.resize(num_rows);
+    file.read(reinterpret_cast<char*>(x_coords.data()), num_cols * sizeof(double));
+    file.read(reinterpret_cast<char*>(y_coords.data()), num_rows * sizeof(double));
+    previous.assign(static_cast<size_t>(num_cols) * num_rows, 0);
+    return static_cast<bool>(file);
+}
+
+bool FieldReader::next(double& time, Matrix& field, uint64_t* step) {
+    FrameHeader frame_header;
+    if (!file.read(reinterpret_cast<char*>(&frame_header), sizeof(frame_header))) {
+        return false;
+    }
+    payload.resize(frame_header.payload_size);
+    if (!file.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size()))) {
+        return false;
+    }
+
+    bool float32 = (flags & kFlagFloat32) != 0;
+    bool keyframe = (frame_header.flags & kFrameKeyframe) != 0;
+    size_t width = float32 ? sizeof(float) : sizeof(double);
+    size_t count = previous.size();
+    if (!decodeZeroRuns(payload, shuffled, count * width)) {
+        std::cerr << "圧力分布ファイルのフレームが壊れています" << std::endl;
+        return false;
+    }
+
+    field.resize(num_rows, num_cols);
+    for (size_t k = 0; k < count; ++k) {
+        uint64_t coded = 0;
+        for (size_t b = 0; b < width; ++b) {
+            coded |= static_cast<uint64_t>(shuffled[b * count + k]) << (8 * b);
+        }
+        uint64_t bits = keyframe ? coded : (coded ^ previous[k]);
+        previous[k] = bits;
+        // 行優先で格納されている
+        field(static_cast<int>(k / num_cols), static_cast<int>(k % num_cols)) = fromBits(bits, float32);
+    }
+
+    time = frame_header.time;
+    if (step) {
+        *step = frame_header.step;
+    }
+    return true;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * 圧力分布の時系列を圧縮バイナリ（.pdfield）に書き出すライター
+ *
+ * 呼び出し側は push() で間引いた値をキューに積むだけで、符号化と書き込みは
+ * バックグラウンドのスレッドが行う。キューが満杯のときだけ push() は待つ。
+ *
+ * 各フレームの符号化:
+ *   1. 空間方向の間引き（stride ごとの節点と最後の節点）
+ *   2. float32への量子化（既定、無効にすればfloat64のまま）
+ *   3. 前フレームとのビットXOR（キーフレームは差分なし）
+ *   4. バイト面への並べ替え（各値の同じ桁のバイトを連続させる）
+ *   5. ゼロバイトの連長圧縮
+ * 3〜5は可逆なので、量子化以外で値は変わらない。
+ *
+ * ファイル構成（ネイティブのバイト順）:
+ *   ヘッダー（32バイト）: マジック, バイト順, フラグ, 列数, 行数, キーフレーム間隔
+ *   x座標（列数分のdouble）, y座標（行数分のdouble）
+ *   フレーム: フレームヘッダー（ステップ番号, 時刻, フラグ, ペイロード長）+ ペイロード
+ */
+class FieldWriter {
+public:
+    using Matrix = Eigen::MatrixXd;
+    using Vector = Eigen::VectorXd;
+
+    /**
+     * 出力の設定
+     */
+    struct Options {
+        int spatial_stride;        // 空間方向の間引き間隔（1なら全節点）
+        int temporal_stride;       // 時間方向の間引き間隔（1なら全ステップ）
+        bool quantize_float32;     // float32へ量子化するかどうか
+        bool delta_encoding;       // 前フレームとの差分で符号化するかどうか
+        int keyframe_interval;     // 差分なしのフレームを挟む間隔（フレーム数）
+        size_t queue_capacity;     // 書き込み待ちのフレーム数の上限
+
+        Options()
+            : spatial_stride(1), temporal_stride(1), quantize_float32(true),
+              delta_encoding(true), keyframe_interval(32), queue_capacity(8) {}
+    };
+
+private:
+    struct Frame {
+        uint64_t step;
+        double time;
+        std::vector<double> values;
+    };
+
+    Options options;
+    std::vector<int> col_index;    // 出力する列（x方向の節点番号）
+    std::vector<int> row_index;    // 出力する行（y方向の節点番号）
+    std::ofstream file;
+    std::string filename;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable queue_not_empty;
+    std::condition_variable queue_not_full;
+    std::deque<Frame> queue;
+    bool closing;
+    std::atomic<bool> failed;
+
+    uint64_t steps_pushed;
+    uint64_t frames_written;
+    uint64_t raw_bytes;            // float64で全節点を書いた場合のバイト数
+    uint64_t bytes_written;
+
+public:
+    FieldWriter();
+    ~FieldWriter();
+
+    FieldWriter(const FieldWriter&) = delete;
+    FieldWriter& operator=(const FieldWriter&) = delete;
+
+    /**
+     * 出力ファイルを開き、書き込みスレッドを開始する
+     * @param filename ファイル名
+     * @param x x方向の節点座標（圧力分布の列）
+     * @param y y方向の節点座標（圧力分布の行）
+     * @param options 出力の設定
+     * @return 成功したかどうか
+     */
+    bool open(const std::string& filename, const Vector& x, const Vector& y,
+              const Options& options = Options());
+
+    /**
+     * 1ステップの圧力分布を書き込み待ちに積む（時間方向の間引き対象なら何もしない）
+     * @param time 時刻 [s]
+     * @param field 圧力分布（y.size() × x.size()）
+     * @return 受け付けたかどうか（書き込みエラー後はfalse）
+     */
+    bool push(double time, const Matrix& field);
+
+    /**
+     * 残りのフレームを書き出してファイルを閉じる
+     * @return すべてのフレームを書き込めたかどうか
+     */
+    bool close();
+
+    bool isOpen() const { return file.is_open(); }
+    uint64_t framesWritten() const { return frames_written; }
+    uint64_t bytesWritten() const { return bytes_written; }
+
+    /**
+     * 間引き・圧縮前（float64・全節点）に対するファイルサイズの比
+     */
+    double compressionRatio() const;
+
+private:
+    void writerLoop(std::vector<double> x_out, std::vector<double> y_out);
+};
+
+/**
+ * FieldWriterで書いたファイルを先頭から順に読むリーダー
+ */
+class FieldReader {
+public:
+    using Matrix = Eigen::MatrixXd;
+    using Vector = Eigen::VectorXd;
+
+private:
+    std::ifstream file;
+    uint32_t flags;
+    int num_cols;
+    int num_rows;
+    Vector x_coords;
+    Vector y_coords;
+    std::vector<uint64_t> previous;   // 前フレームのビット列
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> shuffled;
+
+public:
+    FieldReader();
+
+    /**
+     * ファイルを開いてヘッダーを読む
+     * @param filename ファイル名
+     * @return 成功したかどうか
+     */
+    bool open(const std::string& filename);
+
+    int cols() const { return num_cols; }
+    int rows() const { return num_rows; }
+    const Vector& x() const { return x_coords; }
+    const Vector& y() const { return y_coords; }
+
+    /**
+     * 次のフレームを読む
+     * @param time 時刻 [s]
+     * @param field 圧力分布（rows() × cols()）
+     * @param step nullptrでなければ元のステップ番号を格納する
+     * @return 読めたかどうか（終端または不正なデータならfalse）
+     */
+    bool next(double& time, Matrix& field, uint64_t* step = nullptr);
+};
@@ -0,0 +1,309 @@
+#include "incremental_evaluator.hpp"
+#include "time_series_engine.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// 記憶の上限（超えたら消してから記憶し直す）
+constexpr size_t kMaxMemoEntries = size_t(1) << 20;
+
+// 圧力分布を並列に求めるとき一度に解くキーフレーム数（保持する圧力分布の数の目安）
+constexpr size_t kFieldBlock = 64;
+
+std::array<double, 4> stateAt(const EdgePressureSeries& series, size_t i) {
+    return {series.bottom[i], series.right[i], series.top[i], series.left[i]};
+}
+
+// 境界値 s を a→b の線分へ射影した位置（0〜1）
+double projectOnSegment(const std::array<double, 4>& s, const std::array<double, 4>& a,
+                        const std::array<double, 4>& b) {
+    double dot = 0.0, length2 = 0.0;
+    for (int e = 0; e < 4; ++e) {
+        double d = b[e] - a[e];
+        dot += (s[e] - a[e]) * d;
+        length2 += d * d;
+    }
+    if (!(length2 > 0.0)) {
+        return 0.0;
+    }
+    return std::clamp(dot / length2, 0.0, 1.0);
+}
+
+}
+
+size_t IncrementalEvaluator::StateKeyHash::operator()(const StateKey& key) const {
+    uint64_t h = 0x9e3779b97f4a7c15ull;
+    for (uint64_t v : key) {
+        h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    }
+    return static_cast<size_t>(h);
+}
+
+IncrementalEvaluator::IncrementalEvaluator(SquareThinFilmFDM& solver, double tolerance, Fill fill, int num_threads)
+    : solver(solver), tolerance(std::max(tolerance, 0.0)), fill(fill), num_threads(num_threads),
+      has_previous(false), previous_state{0.0, 0.0, 0.0, 0.0}, previous_force(0.0) {}
+
+bool IncrementalEvaluator::parseFill(const std::string& text, Fill& fill) {
+    if (text == "hold") {
+        fill = Fill::Hold;
+    } else if (text == "linear") {
+        fill = Fill::Linear;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void IncrementalEvaluator::reset() {
+    memo.clear();
+    has_previous = false;
+    previous_field = Matrix();
+}
+
+IncrementalEvaluator::StateKey IncrementalEvaluator::quantize(const EdgeState& state) const {
+    StateKey key;
+    for (int e = 0; e < 4; ++e) {
+        if (tolerance > 0.0) {
+            // 許容差の幅のセルの番号（同じセルの境界値は各辺の差が許容差未満）
+            key[e] = static_cast<uint64_t>(std::llround(state[e] / tolerance));
+        } else {
+            double value = state[e] + 0.0;  // -0 を +0 にそろえる
+            std::memcpy(&key[e], &value, sizeof(double));
+        }
+    }
+    return key;
+}
+
+bool IncrementalEvaluator::withinTolerance(const EdgeState& a, const EdgeState& b) const {
+    for (int e = 0; e < 4; ++e) {
+        if (!(std::abs(a[e] - b[e]) <= tolerance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IncrementalEvaluator::solveState(const EdgeState& state, double& force, Matrix* field) {
+    solver.setEdgeBoundary(state[0], state[1], state[2], state[3]);
+    if (!solver.solveWithCachedMatrix()) {
+        return false;
+    }
+    force = solver.calculateTotalForce();
+    if (field) {
+        *field = solver.getPressureField();
+    }
+    return true;
+}
+
+bool IncrementalEvaluator::solveStates(const std::vector<EdgeState>& states, std::vector<double>& forces,
+                                       std::vector<Matrix>* fields) {
+    PD_TRACE_COUNT("incremental.solves", states.size());
+    stats.solves += states.size();
+    if (states.empty()) {
+        forces.clear();
+        return true;
+    }
+
+    // 直接法なら分解を共有して並列に解く（全ステップを解く場合と同じ経路）
+    if (solver.supportsConcurrentSolve()) {
+        std::vector<double> edges[4];
+        for (int e = 0; e < 4; ++e) {
+            edges[e].reserve(states.size());
+            for (const EdgeState& s : states) {
+                edges[e].push_back(s[e]);
+            }
+        }
+        TimeSeriesEngine engine(solver, num_threads);
+        return engine.run(edges[0], edges[1], edges[2], edges[3], forces, fields);
+    }
+
+    // 反復法・キャビテーションは前の解を初期値に使うので時刻の順に解く
+    forces.assign(states.size(), 0.0);
+    if (fields) {
+        fields->assign(states.size(), Matrix());
+    }
+    for (size_t k = 0; k < states.size(); ++k) {
+        if (!solveState(states[k], forces[k], fields ? &(*fields)[k] : nullptr)) {
+            std::cerr << "キーフレームの求解に失敗しました" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IncrementalEvaluator::run(const EdgePressureSeries& series, std::vector<double>& forces,
+                               const FieldCallback& on_field) {
+    PD_TRACE_SCOPE("incremental.run");
+    size_t num_steps = series.size();
+    forces.assign(num_steps, 0.0);
+    if (num_steps == 0) {
+        return true;
+    }
+    bool with_fields = static_cast<bool>(on_field);
+
+    // キーフレーム（source は結果を受け取るキーフレーム、自分自身なら自分で解く）
+    struct Key {
+        EdgeState state;
+        double force;
+        bool known;      // 前のチャンクから引き継いだか、記憶から得た
+        size_t source;
+    };
+    std::vector<Key> keys;
+    std::vector<size_t> frame_key(num_steps);
+
+    // 直前のチャンクの最後のキーフレームを引き継ぐ（圧力分布が要るのに持っていなければ引き継がない）
+    bool carried = has_previous && (!with_fields || previous_field.size() > 0);
+    if (carried) {
+        keys.push_back({previous_state, previous_force, true, 0});
+    }
+
+    // 各ステップを直前のキーフレームと比べてキーフレームを選ぶ
+    {
+        PD_TRACE_SCOPE("incremental.plan");
+        std::unordered_map<StateKey, size_t, StateKeyHash> pending;  // このチャンクで解くキーフレーム
+        for (size_t i = 0; i < num_steps; ++i) {
+            EdgeState s = stateAt(series, i);
+            if (!keys.empty() && withinTolerance(s, keys.back().state)) {
+                frame_key[i] = keys.size() - 1;
+                if (s == keys.back().state) {
+                    stats.repeated++;
+                } else {
+                    stats.approximated++;
+                }
+                continue;
+            }
+            Key key{s, 0.0, false, keys.size()};
+            if (!with_fields) {
+                StateKey q = quantize(s);
+                auto hit = memo.find(q);
+                if (hit != memo.end()) {
+                    key.force = hit->second;
+                    key.known = true;
+                    stats.memo_hits++;
+                } else {
+                    auto inserted = pending.emplace(q, keys.size());
+                    if (!inserted.second) {
+                        key.source = inserted.first->second;
+                        stats.memo_hits++;
+                    }
+                }
+            }
+            frame_key[i] = keys.size();
+            keys.push_back(key);
+        }
+    }
+    stats.frames += num_steps;
+
+    // 前後のキーフレームの間での位置（Holdなら常に0）
+    auto interpolationWeight = [&](size_t i) {
+        size_t a = frame_key[i];
+        if (fill != Fill::Linear || a + 1 >= keys.size()) {
+            return 0.0;
+        }
+        return projectOnSegment(stateAt(series, i), keys[a].state, keys[a + 1].state);
+    };
+
+    if (!with_fields) {
+        // 合力だけなら解くキーフレームをまとめて解く
+        std::vector<size_t> solve_keys;
+        std::vector<EdgeState> states;
+        for (size_t k = 0; k < keys.size(); ++k) {
+            if (!keys[k].known && keys[k].source == k) {
+                solve_keys.push_back(k);
+                states.push_back(keys[k].state);
+            }
+        }
+        std::vector<double> solved;
+        if (!solveStates(states, solved, nullptr)) {
+            forces.clear();
+            return false;
+        }
+        if (memo.size() + solve_keys.size() > kMaxMemoEntries) {
+            memo.clear();
+        }
+        for (size_t j = 0; j < solve_keys.size(); ++j) {
+            Key& key = keys[solve_keys[j]];
+            key.force = solved[j];
+            memo[quantize(key.state)] = solved[j];
+        }
+        for (size_t k = 0; k < keys.size(); ++k) {
+            if (!keys[k].known && keys[k].source != k) {
+                keys[k].force = keys[keys[k].source].force;
+            }
+        }
+        for (size_t i = 0; i < num_steps; ++i) {
+            size_t a = frame_key[i];
+            double t = interpolationWeight(i);
+            forces[i] = t == 0.0 ? keys[a].force : keys[a].force + t * (keys[a + 1].force - keys[a].force);
+        }
+    } else {
+        // 圧力分布は前後のキーフレームの分だけを持てばよいので、時刻の順に少しずつ解く
+        // window はキーフレーム [window_begin, window_begin + window.size()) の圧力分布
+        std::vector<Matrix> window;
+        size_t window_begin = 0;
+        if (carried) {
+            window.push_back(previous_field);
+        }
+        size_t block = solver.supportsConcurrentSolve() ? kFieldBlock : 1;
+        auto ensureFields = [&](size_t first, size_t last) {
+            size_t window_end = window_begin + window.size();
+            if (last < window_end) {
+                return true;
+            }
+            // first より前のキーフレームの圧力分布はもう使わない
+            size_t drop = std::min(first - window_begin, window.size());
+            window.erase(window.begin(), window.begin() + drop);
+            window_begin += drop;
+
+            size_t target = std::min(keys.size(), std::max(last + 1, window_end + block));
+            std::vector<EdgeState> states;
+            for (size_t k = window_end; k < target; ++k) {
+                states.push_back(keys[k].state);
+            }
+            std::vector<double> solved;
+            std::vector<Matrix> fields;
+            if (!solveStates(states, solved, &fields)) {
+                return false;
+            }
+            for (size_t j = 0; j < states.size(); ++j) {
+                keys[window_end + j].force = solved[j];
+                window.push_back(std::move(fields[j]));
+            }
+            return true;
+        };
+
+        Matrix blended;
+        for (size_t i = 0; i < num_steps; ++i) {
+            size_t a = frame_key[i];
+            double t = interpolationWeight(i);
+            if (!ensureFields(a, t == 0.0 ? a : a + 1)) {
+                forces.clear();
+                return false;
+            }
+            const Matrix& field_a = window[a - window_begin];
+            if (t == 0.0) {
+                forces[i] = keys[a].force;
+                on_field(i, field_a);
+            } else {
+                const Matrix& field_b = window[a + 1 - window_begin];
+                forces[i] = keys[a].force + t * (keys[a + 1].force - keys[a].force);
+                blended = (1.0 - t) * field_a + t * field_b;
+                on_field(i, blended);
+            }
+        }
+        previous_field = window.back();
+    }
+
+    // 最後のキーフレームを次のチャンクへ引き継ぐ
+    has_previous = true;
+    previous_state = keys.back().state;
+    previous_force = keys.back().force;
+    if (!with_fields) {
+        previous_field = Matrix();
+    }
+    return true;
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "edge_series.hpp"
+#include "pressuredistsolver.hpp"
+
+/**
+ * 境界圧力がくり返す・ほとんど変わらないステップの求解を省く時系列の評価器
+ *
+ * 各ステップの4辺の圧力を直前のキーフレーム（実際に解いたステップ）と比べ、
+ * どの辺の差も許容差以下ならそのステップは解かずにキーフレームの結果を使う。
+ * 許容差を超えたステップが次のキーフレームになる。許容差0では境界値がまったく同じ
+ * ステップだけを省くので、結果は全ステップを解いた場合と一致する。
+ *
+ * キーフレームの間のステップは、直前のキーフレームの値を保持するか（Hold）、
+ * 前後のキーフレームの境界値を結ぶ線分へ射影した位置で線形補間する（Linear）。
+ * キャビテーションを考慮しなければ合力・圧力分布は境界値の一次関数なので、
+ * 境界値がキーフレームの間を直線的に変化する区間では補間は解いた結果と一致する。
+ *
+ * 合力だけを求める場合は、解いた結果を量子化した境界値（量子 = 許容差、0ならビット列）で
+ * 記憶し、離れたステップで同じ状態に戻ったときも解き直さない。
+ * 直前のキーフレームと記憶は run() の呼び出し（チャンク）をまたいで引き継ぐ。
+ * チャンクの最後のキーフレーム以降のステップは、Linear でも保持になる。
+ */
+class IncrementalEvaluator {
+public:
+    using Matrix = SquareThinFilmFDM::Matrix;
+
+    /**
+     * キーフレームの間のステップの求め方
+     */
+    enum class Fill {
+        Hold,    // 直前のキーフレームの値
+        Linear   // 前後のキーフレームから線形補間
+    };
+
+    /**
+     * 評価の統計（run() の呼び出しをまたいで累積）
+     */
+    struct Stats {
+        size_t frames = 0;        // 評価したステップ数
+        size_t solves = 0;        // 実際に解いた回数
+        size_t repeated = 0;      // 直前のキーフレームと境界値が同じステップ
+        size_t approximated = 0;  // 許容差以内で解かずに保持・補間したステップ
+        size_t memo_hits = 0;     // 記憶した結果を使ったキーフレーム
+
+        size_t avoided() const { return frames - solves; }
+    };
+
+    /**
+     * 圧力分布を受け取る関数（ステップの順に呼ばれる）
+     * @param index run() に渡した時系列でのステップ番号
+     * @param field 圧力分布
+     */
+    using FieldCallback = std::function<void(size_t index, const Matrix& field)>;
+
+private:
+    using EdgeState = std::array<double, 4>;      // 下・右・上・左の圧力 [Pa]
+    using StateKey = std::array<uint64_t, 4>;     // 量子化した境界値
+
+    struct StateKeyHash {
+        size_t operator()(const StateKey& key) const;
+    };
+
+    SquareThinFilmFDM& solver;
+    double tolerance;        // キーフレームとの差の許容値 [Pa]（各辺の差の最大値）
+    Fill fill;
+    int num_threads;         // 並列に解くときのスレッド数（0以下ならハードウェアのスレッド数）
+
+    std::unordered_map<StateKey, double, StateKeyHash> memo;  // 量子化した境界値 → 合力
+
+    // 直前の run() の最後のキーフレーム
+    bool has_previous;
+    EdgeState previous_state;
+    double previous_force;
+    Matrix previous_field;   // 圧力分布を求めた場合のみ
+
+    Stats stats;
+
+public:
+    /**
+     * コンストラクタ
+     * @param solver 分解済みのソルバー
+     * @param tolerance キーフレームとの差の許容値 [Pa]（0なら同じ境界値のステップだけを省く）
+     * @param fill キーフレームの間のステップの求め方
+     * @param num_threads 並列に解くときのスレッド数（0以下ならハードウェアのスレッド数）
+     */
+    explicit IncrementalEvaluator(SquareThinFilmFDM& solver, double tolerance = 0.0,
+                                  Fill fill = Fill::Hold, int num_threads = 0);
+
+    /**
+     * 時系列の各ステップの合力を求める
+     *
+     * 解くキーフレームは、直接法（supportsConcurrentSolve()）なら並列に、
+     * 反復法・キャビテーションでは前のキーフレームの解を初期値に使えるよう時刻の順に解く。
+     * @param series 境界圧力の時系列
+     * @param forces 各ステップの合力 [N]
+     * @param on_field 空でなければ各ステップの圧力分布を渡す（記憶は使わない）
+     * @return すべてのキーフレームで解が成功したかどうか
+     */
+    bool run(const EdgePressureSeries& series, std::vector<double>& forces,
+             const FieldCallback& on_field = nullptr);
+
+    /**
+     * 直前のキーフレームと記憶を消す（統計は残す）
+     */
+    void reset();
+
+    const Stats& getStats() const { return stats; }
+
+    /**
+     * 補間方法の名前（hold, linear）を解釈する
+     * @return 既知の名前かどうか
+     */
+    static bool parseFill(const std::string& text, Fill& fill);
+
+private:
+    StateKey quantize(const EdgeState& state) const;
+
+    bool withinTolerance(const EdgeState& a, const EdgeState& b) const;
+
+    /**
+     * 1つの境界値で圧力場を解く（ソルバーの圧力場を更新する）
+     * @param field nullptrでなければ圧力分布を格納する
+     */
+    bool solveState(const EdgeState& state, double& force, Matrix* field);
+
+    /**
+     * 複数の境界値の合力を求める（直接法なら並列）
+     */
+    bool solveStates(const std::vector<EdgeState>& states, std::vector<double>& forces,
+                     std::vector<Matrix>* fields);
+};
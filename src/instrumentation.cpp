@@ -0,0 +1,275 @@
+#include "instrumentation.hpp"
+#include "resource_usage.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace instrumentation {
+
+namespace {
+
+// 1スレッドあたりのイベント数の上限（超えた分は集計のみ行う）
+constexpr size_t kMaxEventsPerThread = size_t(1) << 20;
+
+/**
+ * 計測箇所ごとの集計（区間は秒、カウンターは値）
+ */
+struct SiteStats {
+    uint64_t count = 0;
+    double total = 0.0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = 0.0;
+    bool is_count = false;
+
+    void add(double value) {
+        ++count;
+        total += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+
+    void merge(const SiteStats& other) {
+        count += other.count;
+        total += other.total;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        is_count = is_count || other.is_count;
+    }
+};
+
+/**
+ * 区間のイベント（計測開始からのナノ秒）
+ */
+struct Event {
+    int site;
+    int64_t start_ns;
+    int64_t duration_ns;
+};
+
+/**
+ * スレッドごとの記録領域（書き込むのは所有スレッドだけ）
+ */
+struct ThreadLog {
+    int thread_id = 0;             // 最初に記録した順の番号
+    std::thread::id owner;
+    std::vector<SiteStats> stats;
+    std::vector<Event> events;
+    size_t dropped_events = 0;
+
+    SiteStats& site(int index) {
+        if (static_cast<size_t>(index) >= stats.size()) {
+            stats.resize(index + 1);
+        }
+        return stats[index];
+    }
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::string> site_names;
+    std::vector<std::shared_ptr<ThreadLog>> logs;   // 終了したスレッドの記録も保持する
+    std::vector<std::pair<std::string, double>> values;
+    std::atomic<bool> enabled{false};
+    std::atomic<bool> tracing{false};
+    Clock::time_point origin = Clock::now();
+    std::thread::id main_thread;    // enable() を呼んだスレッド
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadLog& threadLog() {
+    thread_local std::shared_ptr<ThreadLog> log;
+    if (!log) {
+        log = std::make_shared<ThreadLog>();
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        log->thread_id = static_cast<int>(reg.logs.size());
+        log->owner = std::this_thread::get_id();
+        reg.logs.push_back(log);
+    }
+    return *log;
+}
+
+// 全スレッドの集計をまとめる
+std::vector<SiteStats> mergeStats(Registry& reg) {
+    std::vector<SiteStats> merged(reg.site_names.size());
+    for (const auto& log : reg.logs) {
+        for (size_t s = 0; s < log->stats.size() && s < merged.size(); ++s) {
+            merged[s].merge(log->stats[s]);
+        }
+    }
+    return merged;
+}
+
+}
+
+void enable(bool record_trace) {
+    Registry& reg = registry();
+    if (!reg.enabled.load()) {
+        reg.origin = Clock::now();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.main_thread = std::this_thread::get_id();
+    }
+    reg.tracing.store(record_trace || reg.tracing.load());
+    reg.enabled.store(true);
+}
+
+bool isEnabled() {
+    return registry().enabled.load(std::memory_order_relaxed);
+}
+
+int registerSite(const char* name) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto it = std::find(reg.site_names.begin(), reg.site_names.end(), name);
+    if (it != reg.site_names.end()) {
+        return static_cast<int>(it - reg.site_names.begin());
+    }
+    reg.site_names.push_back(name);
+    return static_cast<int>(reg.site_names.size() - 1);
+}
+
+void recordSpan(int site, Clock::time_point start, Clock::time_point end) {
+    ThreadLog& log = threadLog();
+    log.site(site).add(std::chrono::duration<double>(end - start).count());
+
+    Registry& reg = registry();
+    if (!reg.tracing.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (log.events.size() >= kMaxEventsPerThread) {
+        ++log.dropped_events;
+        return;
+    }
+    log.events.push_back({site,
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(start - reg.origin).count(),
+                          std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()});
+}
+
+void recordCount(int site, double value) {
+    SiteStats& stats = threadLog().site(site);
+    stats.is_count = true;
+    stats.add(value);
+}
+
+void setValue(const char* name, double value) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (auto& entry : reg.values) {
+        if (entry.first == name) {
+            entry.second = value;
+            return;
+        }
+    }
+    reg.values.emplace_back(name, value);
+}
+
+void printSummary(std::ostream& out) {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::vector<SiteStats> merged = mergeStats(reg);
+
+    // 区間は合計時間の長い順
+    std::vector<size_t> spans, counters;
+    for (size_t s = 0; s < merged.size(); ++s) {
+        if (merged[s].count == 0) {
+            continue;
+        }
+        (merged[s].is_count ? counters : spans).push_back(s);
+    }
+    std::sort(spans.begin(), spans.end(), [&](size_t a, size_t b) {
+        return merged[a].total > merged[b].total;
+    });
+
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << std::left << std::setw(28) << "span" << std::right << std::setw(12) << "count"
+        << std::setw(14) << "total[ms]" << std::setw(14) << "mean[ms]"
+        << std::setw(14) << "min[ms]" << std::setw(14) << "max[ms]" << "\n";
+    for (size_t s : spans) {
+        const SiteStats& st = merged[s];
+        out << std::left << std::setw(28) << reg.site_names[s] << std::right
+            << std::setw(12) << st.count << std::setw(14) << st.total * 1e3
+            << std::setw(14) << st.total / st.count * 1e3
+            << std::setw(14) << st.min * 1e3 << std::setw(14) << st.max * 1e3 << "\n";
+    }
+    if (!counters.empty()) {
+        out << std::left << std::setw(28) << "counter" << std::right << std::setw(12) << "count"
+            << std::setw(14) << "sum" << std::setw(12) << "max" << "\n";
+        out << std::setprecision(0);
+        for (size_t s : counters) {
+            const SiteStats& st = merged[s];
+            out << std::left << std::setw(28) << reg.site_names[s] << std::right
+                << std::setw(12) << st.count << std::setw(14) << st.total << std::setw(12) << st.max << "\n";
+        }
+    }
+    for (const auto& entry : reg.values) {
+        out << std::left << std::setw(28) << entry.first << std::right << std::setprecision(0)
+            << std::setw(12) << entry.second << "\n";
+    }
+    out << std::left << std::setw(28) << "peak_rss[MiB]" << std::right << std::setprecision(1)
+        << std::setw(12) << resource_usage::peakResidentBytes() / (1024.0 * 1024.0) << "\n";
+
+    size_t dropped = 0;
+    for (const auto& log : reg.logs) {
+        dropped += log->dropped_events;
+    }
+    if (dropped > 0) {
+        out << "トレースの上限を超えたため記録しなかったイベント: " << dropped << "\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool writeChromeTrace(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file) {
+        return false;
+    }
+
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto separator = [&]() -> std::ofstream& {
+        if (!first) {
+            file << ",\n";
+        }
+        first = false;
+        return file;
+    };
+    file << std::fixed << std::setprecision(3);
+    for (const auto& log : reg.logs) {
+        bool is_main = log->owner == reg.main_thread;
+        separator() << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << log->thread_id
+                    << ",\"args\":{\"name\":\"" << (is_main ? "main" : "worker ")
+                    << (is_main ? "" : std::to_string(log->thread_id)) << "\"}}";
+        for (const Event& e : log->events) {
+            // 時刻はマイクロ秒
+            separator() << "{\"name\":\"" << reg.site_names[e.site] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                        << log->thread_id << ",\"ts\":" << e.start_ns * 1e-3
+                        << ",\"dur\":" << e.duration_ns * 1e-3 << "}";
+        }
+    }
+    file << "\n],\"otherData\":{";
+    file << std::setprecision(0);
+    for (const auto& entry : reg.values) {
+        file << "\"" << entry.first << "\":" << entry.second << ",";
+    }
+    file << "\"peak_rss_bytes\":" << resource_usage::peakResidentBytes() << "}}\n";
+    return static_cast<bool>(file);
+}
+
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+/**
+ * 処理区間の計測（スコープタイマー・カウンター）
+ *
+ * 計測箇所にはマクロを置く:
+ *
+ *     PD_TRACE_SCOPE("solver.factorize");        // スコープを抜けるまでの時間
+ *     PD_TRACE_COUNT("csv.rows", chunk.num_rows); // 値の合計・最大
+ *     PD_TRACE_VALUE("factor.nnz_L", nnz);        // 最後に設定した値
+ *
+ * PRESSUREDIST_INSTRUMENTATION を定義しないでビルドするとマクロは空になり、
+ * 計測のコードは残らない。定義した場合も enable() を呼ぶまでは各計測箇所で
+ * フラグを1回読むだけで何も記録しない。
+ *
+ * 各スレッドは自分の記録領域にだけ書き込むので、計測箇所でロックは取らない。
+ * 集計（printSummary, writeChromeTrace）は計測対象の処理が終わってから呼ぶこと。
+ */
+namespace instrumentation {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * 計測箇所がビルドに含まれているかどうか（PRESSUREDIST_INSTRUMENTATION）
+ */
+#ifdef PRESSUREDIST_INSTRUMENTATION
+constexpr bool kCompiledIn = true;
+#else
+constexpr bool kCompiledIn = false;
+#endif
+
+/**
+ * 計測を開始する（最初に呼んだスレッドがトレースの main になる）
+ * @param record_trace 区間ごとのイベントも記録するかどうか（writeChromeTrace用）
+ */
+void enable(bool record_trace = false);
+
+/**
+ * 計測が有効かどうか
+ */
+bool isEnabled();
+
+/**
+ * 計測箇所を登録する（マクロから各箇所で一度だけ呼ばれる）
+ * @param name 計測箇所の名前（文字列リテラル）
+ * @return 計測箇所の番号
+ */
+int registerSite(const char* name);
+
+/**
+ * 区間の時間を記録する
+ * @param site 計測箇所の番号
+ * @param start 開始時刻
+ * @param end 終了時刻
+ */
+void recordSpan(int site, Clock::time_point start, Clock::time_point end);
+
+/**
+ * カウンターに値を加える
+ * @param site 計測箇所の番号
+ * @param value 値
+ */
+void recordCount(int site, double value);
+
+/**
+ * 名前付きの値を設定する（分解の非ゼロ数など、最後に設定した値を出力する）
+ * @param name 名前
+ * @param value 値
+ */
+void setValue(const char* name, double value);
+
+/**
+ * 集計表を出力する（区間ごとの回数・合計・平均・最小・最大、カウンター、値、ピークRSS）
+ * @param out 出力先
+ */
+void printSummary(std::ostream& out);
+
+/**
+ * 記録したイベントをChrome trace形式（chrome://tracing, Perfetto で表示できるJSON）で書き出す
+ * @param filename ファイル名
+ * @return 成功したかどうか
+ */
+bool writeChromeTrace(const std::string& filename);
+
+/**
+ * スコープを抜けるまでの時間を記録するタイマー
+ */
+class ScopedTimer {
+private:
+    int site;
+    bool active;
+    Clock::time_point start;
+
+public:
+    explicit ScopedTimer(int site) : site(site), active(isEnabled()) {
+        if (active) {
+            start = Clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (active) {
+            recordSpan(site, start, Clock::now());
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+}
+
+#ifdef PRESSUREDIST_INSTRUMENTATION
+
+#define PD_TRACE_CONCAT_IMPL(a, b) a##b
+#define PD_TRACE_CONCAT(a, b) PD_TRACE_CONCAT_IMPL(a, b)
+
+#define PD_TRACE_SCOPE(name)                                                                  \
+    static const int PD_TRACE_CONCAT(pd_trace_site_, __LINE__) =                              \
+        ::instrumentation::registerSite(name);                                                \
+    ::instrumentation::ScopedTimer PD_TRACE_CONCAT(pd_trace_timer_, __LINE__)(                \
+        PD_TRACE_CONCAT(pd_trace_site_, __LINE__))
+
+#define PD_TRACE_COUNT(name, value)                                                           \
+    do {                                                                                      \
+        if (::instrumentation::isEnabled()) {                                                 \
+            static const int pd_trace_site = ::instrumentation::registerSite(name);           \
+            ::instrumentation::recordCount(pd_trace_site, static_cast<double>(value));        \
+        }                                                                                     \
+    } while (0)
+
+#define PD_TRACE_VALUE(name, value)                                                           \
+    do {                                                                                      \
+        if (::instrumentation::isEnabled()) {                                                 \
+            ::instrumentation::setValue(name, static_cast<double>(value));                    \
+        }                                                                                     \
+    } while (0)
+
+#else
+
+#define PD_TRACE_SCOPE(name) do {} while (0)
+#define PD_TRACE_COUNT(name, value) do {} while (0)
+#define PD_TRACE_VALUE(name, value) do {} while (0)
+
+#endif
@@ -1,142 +1,641 @@
 #include "pressuredistsolver.hpp"
 #include "csv_reader.hpp"
+#include "time_series_engine.hpp"
+#include "edge_series.hpp"
+#include "batch_runner.hpp"
+#include "columnar_file.hpp"
+#include "field_writer.hpp"
+#include "instrumentation.hpp"
+#include "solver_server.hpp"
+#include "incremental_evaluator.hpp"
+#include <csignal>
 #include <iostream>
 #include <vector>
 #include <filesystem>
+#include <fstream>
 #include <iomanip>
+#include <string>
+#include <cstdlib>
 
-// 特定の時間の圧力値を取得する関数
-std::vector<double> extractPressureValues(const CSVReader::CSVData& data, 
-                                        const std::vector<double>& time_values) {
-    std::vector<double> pressure_values;
-    
-    for (double t : time_values) {
-        // 最も近い時間のデータを取得
-        size_t idx = data.findClosestTimeIndex("simulation_time", t);
-        const auto& pressure_col = data.getColumn("pressure_ave");
-        pressure_values.push_back(pressure_col[idx]);
+// 合力オペレータを準備する関数
+// キャッシュディレクトリが空でなければ、同じ格子・膜厚で保存したオペレータを読み込む（分解を省略）
+bool buildForceOperator(SquareThinFilmFDM& solver, const std::string& operator_cache_dir) {
+    std::cout << "システム行列を構築・分解中..." << std::endl;
+    if (!operator_cache_dir.empty()) {
+        if (!solver.buildForceOperatorCached(operator_cache_dir)) {
+            std::cerr << "合力オペレータの構築に失敗しました" << std::endl;
+            return false;
+        }
+    } else {
+        if (!solver.buildAndFactorizeMatrix()) {
+            std::cerr << "システム行列の構築・分解に失敗しました" << std::endl;
+            return false;
+        }
+        if (!solver.buildForceOperator()) {
+            std::cerr << "合力オペレータの構築に失敗しました" << std::endl;
+            return false;
+        }
     }
-    
-    return pressure_values;
-}
-
-// 境界条件を時間ステップごとに設定する関数
-void setBoundaryAtTime(SquareThinFilmFDM& solver, double t, 
-                      const std::vector<double>& time_values,
-                      const std::vector<double>& bottom_pressures,
-                      const std::vector<double>& right_pressures,
-                      const std::vector<double>& top_pressures,
-                      const std::vector<double>& left_pressures) {
-    // 最も近い時間インデックスを見つける
-    size_t idx = 0;
-    double min_diff = std::abs(time_values[0] - t);
-    
-    for (size_t i = 1; i < time_values.size(); ++i) {
-        double diff = std::abs(time_values[i] - t);
-        if (diff < min_diff) {
-            min_diff = diff;
-            idx = i;
-        }
-    }
-    
-    // その時間での各辺の圧力を設定
-    solver.setEdgeBoundary(
-        bottom_pressures[idx],
-        right_pressures[idx],
-        top_pressures[idx],
-        left_pressures[idx]
-    );
+    std::cout << "システム行列の構築・分解が完了しました" << std::endl;
+    if (solver.getActiveBackend() == SquareThinFilmFDM::SolverBackend::MixedPrecisionLU) {
+        // 随伴問題の反復改良の収束状況
+        const auto& stats = solver.getLastSolveStats();
+        std::cout << "反復改良: " << stats.iterations << " 回, 相対残差 " << stats.residual << std::endl;
+    }
+    return true;
 }
 
-// 時系列での合力を計算する関数（最適化版）
+// 時系列での合力を計算する関数（オペレータモード）
 std::vector<double> calculateForceTimeSeries(SquareThinFilmFDM& solver,
                                            const std::vector<double>& time_values,
                                            const std::vector<double>& bottom_pressures,
                                            const std::vector<double>& right_pressures,
                                            const std::vector<double>& top_pressures,
-                                           const std::vector<double>& left_pressures) {
+                                           const std::vector<double>& left_pressures,
+                                           const std::string& operator_cache_dir) {
     std::vector<double> forces;
     
-    // 最初の時間ステップでシステム行列を構築・LU分解
-    // 2ステップ以降は飛ばされる
-    if (!time_values.empty()) {
-        setBoundaryAtTime(solver, time_values[0], time_values, 
-                         bottom_pressures, right_pressures, 
-                         top_pressures, left_pressures);
-        
-        std::cout << "システム行列を構築・分解中..." << std::endl;
-        if (!solver.buildAndFactorizeMatrix()) {
-            std::cerr << "システム行列の構築・分解に失敗しました" << std::endl;
-            return forces;
-        }
-        std::cout << "システム行列の構築・分解が完了しました" << std::endl;
+    // 最初にシステム行列を構築・LU分解し、境界値→合力のオペレータを事前計算する
+    // 各ステップの合力は境界値との内積だけで求まる
+    if (!time_values.empty() && !buildForceOperator(solver, operator_cache_dir)) {
+        return forces;
     }
     
+    PD_TRACE_SCOPE("operator.evaluate");
+    forces.reserve(time_values.size());
     for (size_t i = 0; i < time_values.size(); ++i) {
-        // 境界条件を設定
-        setBoundaryAtTime(solver, time_values[i], time_values, 
-                         bottom_pressures, right_pressures, 
-                         top_pressures, left_pressures);
+        // 境界値（時刻はそろえ済み）から合力を計算して記録
+        double force = solver.calculateForceFromEdges(
+            bottom_pressures[i],
+            right_pressures[i],
+            top_pressures[i],
+            left_pressures[i]
+        );
+        forces.push_back(force);
+    }
+    std::cout << "計算完了: " << forces.size() << " ステップ" << std::endl;
+    
+    return forces;
+}
+
+// 合力オペレータで各ステップの一次モーメント・圧力中心を計算する関数
+// 全ステップで圧力場を解くモードでも、分解済みなら随伴問題を解いてオペレータを構築する
+bool calculateLoadTimeSeries(SquareThinFilmFDM& solver,
+                             const EdgePressureSeries& series,
+                             std::vector<SquareThinFilmFDM::LoadIntegrals>& loads) {
+    if (!solver.hasForceOperator() && !solver.buildForceOperator()) {
+        std::cerr << "モーメントオペレータの構築に失敗しました" << std::endl;
+        return false;
+    }
+    PD_TRACE_SCOPE("operator.evaluate_loads");
+    loads.resize(series.size());
+    for (size_t i = 0; i < series.size(); ++i) {
+        loads[i] = solver.calculateLoadFromEdges(series.bottom[i], series.right[i],
+                                                 series.top[i], series.left[i]);
+    }
+    return true;
+}
+
+// 分解済みのソルバーで各ステップの圧力場を解いて合力を計算する関数
+// field_writerがnullptrでなければ各ステップの圧力分布も書き出す
+// incrementalがnullptrでなければ、境界値がくり返す・ほとんど変わらないステップを解かずに済ませる
+std::vector<double> solveForceTimeSeries(SquareThinFilmFDM& solver,
+                                         const EdgePressureSeries& series,
+                                         int num_threads,
+                                         FieldWriter* field_writer = nullptr,
+                                         IncrementalEvaluator* incremental = nullptr) {
+    std::vector<double> forces;
+    
+    if (incremental) {
+        IncrementalEvaluator::FieldCallback on_field;
+        if (field_writer) {
+            on_field = [&](size_t i, const SquareThinFilmFDM::Matrix& field) {
+                field_writer->push(series.time[i], field);
+            };
+        }
+        if (!incremental->run(series, forces, on_field)) {
+            std::cerr << "求解に失敗しました" << std::endl;
+            return std::vector<double>();
+        }
+        return forces;
+    }
+    
+    // 直接法なら分解を共有して並列に解く
+    if (solver.supportsConcurrentSolve()) {
+        TimeSeriesEngine engine(solver, num_threads);
+        bool mixed = solver.getActiveBackend() == SquareThinFilmFDM::SolverBackend::MixedPrecisionLU;
+        SquareThinFilmFDM::SolveStats stats{0, 0.0};
+        if (!field_writer) {
+            if (!engine.run(series.bottom, series.right, series.top, series.left, forces, nullptr, &stats)) {
+                std::cerr << "並列求解に失敗しました" << std::endl;
+                return std::vector<double>();
+            }
+            if (mixed) {
+                std::cout << "反復改良: 最大 " << stats.iterations << " 回, 最大相対残差 "
+                          << stats.residual << std::endl;
+            }
+            return forces;
+        }
         
-        // キャッシュされた行列を使って高速に解く
+        // 圧力分布を保持するのは一度に1ブロック分だけにする
+        constexpr size_t block_size = 64;
+        std::vector<double> block_forces;
+        std::vector<SquareThinFilmFDM::Matrix> fields;
+        for (size_t begin = 0; begin < series.size(); begin += block_size) {
+            size_t end = std::min(begin + block_size, series.size());
+            auto slice = [&](const std::vector<double>& v) {
+                return std::vector<double>(v.begin() + begin, v.begin() + end);
+            };
+            if (!engine.run(slice(series.bottom), slice(series.right), slice(series.top),
+                            slice(series.left), block_forces, &fields)) {
+                std::cerr << "並列求解に失敗しました" << std::endl;
+                return std::vector<double>();
+            }
+            forces.insert(forces.end(), block_forces.begin(), block_forces.end());
+            for (size_t k = 0; k < fields.size(); ++k) {
+                field_writer->push(series.time[begin + k], fields[k]);
+            }
+        }
+        return forces;
+    }
+    
+    // 反復法は前ステップの解を初期値に使うので逐次に解く
+    forces.reserve(series.size());
+    for (size_t i = 0; i < series.size(); ++i) {
+        solver.setEdgeBoundary(series.bottom[i], series.right[i], series.top[i], series.left[i]);
         if (!solver.solveWithCachedMatrix()) {
             std::cerr << "Failed to solve at time step " << i << std::endl;
             forces.push_back(0.0);
             continue;
         }
-        
-        // 合力を計算して記録
-        double force = solver.calculateTotalForce();
-        forces.push_back(force);
-        
-        // 進捗表示
-        if ((i + 1) % 10 == 0 || i == time_values.size() - 1) {
-            std::cout << "計算進捗: " << (i + 1) << "/" << time_values.size() << " 完了" << std::endl;
+        forces.push_back(solver.calculateTotalForce());
+        if (field_writer) {
+            field_writer->push(series.time[i], solver.getPressureField());
         }
     }
     
     return forces;
 }
 
-int main() {
+// 時系列での合力を計算する関数（全ステップで圧力場を解く並列版）
+std::vector<double> calculateForceTimeSeriesFullSolve(SquareThinFilmFDM& solver,
+                                                    const EdgePressureSeries& series,
+                                                    int num_threads,
+                                                    FieldWriter* field_writer,
+                                                    IncrementalEvaluator* incremental) {
+    std::cout << "システム行列を構築・分解中..." << std::endl;
+    if (!solver.buildAndFactorizeMatrix()) {
+        std::cerr << "システム行列の構築・分解に失敗しました" << std::endl;
+        return std::vector<double>();
+    }
+    std::cout << "システム行列の構築・分解が完了しました" << std::endl;
+    
+    return solveForceTimeSeries(solver, series, num_threads, field_writer, incremental);
+}
+
+// 境界圧力CSVをチャンク単位で読みながら合力を計算し、結果を逐次書き出す関数
+// ファイル全体を保持しないので長い時系列でもメモリ使用量は一定
+bool calculateForceTimeSeriesStreaming(SquareThinFilmFDM& solver,
+                                       size_t chunk_rows,
+                                       bool full_solve,
+                                       int num_threads,
+                                       TimeIndex::Interpolation interpolation,
+                                       FieldWriter* field_writer,
+                                       IncrementalEvaluator* incremental,
+                                       const std::string& operator_cache_dir,
+                                       bool with_moments,
+                                       const std::string& output_file) {
+    if (full_solve) {
+        std::cout << "システム行列を構築・分解中..." << std::endl;
+        if (!solver.buildAndFactorizeMatrix()) {
+            std::cerr << "システム行列の構築・分解に失敗しました" << std::endl;
+            return false;
+        }
+        std::cout << "システム行列の構築・分解が完了しました" << std::endl;
+    } else if (!buildForceOperator(solver, operator_cache_dir)) {
+        return false;
+    }
+    
+    std::ofstream file(output_file, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "出力ファイルを作成できません: " << output_file << std::endl;
+        return false;
+    }
+    file << "time,force,bottom_pressure,right_pressure,top_pressure,left_pressure";
+    file << (with_moments ? ",moment_x,moment_y,center_x,center_y\n" : "\n");
+    
+    size_t steps_done = 0;
+    std::vector<double> forces;
+    std::vector<SquareThinFilmFDM::LoadIntegrals> loads;
+    std::string buffer;
+    bool completed = streamEdgePressureSeries(".", chunk_rows, [&](const EdgePressureSeries& chunk) {
+        if (full_solve) {
+            forces = solveForceTimeSeries(solver, chunk, num_threads, field_writer, incremental);
+        } else {
+            PD_TRACE_SCOPE("operator.evaluate");
+            forces.resize(chunk.size());
+            for (size_t i = 0; i < chunk.size(); ++i) {
+                forces[i] = solver.calculateForceFromEdges(chunk.bottom[i], chunk.right[i],
+                                                           chunk.top[i], chunk.left[i]);
+            }
+        }
+        if (forces.size() != chunk.size()) {
+            return false;
+        }
+        if (with_moments && !calculateLoadTimeSeries(solver, chunk, loads)) {
+            return false;
+        }
+        
+        // チャンク分をまとめて書き出す（writeCSVと同じ書式）
+        PD_TRACE_SCOPE("output.write_csv");
+        buffer.clear();
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            for (double value : {chunk.time[i], forces[i], chunk.bottom[i],
+                                 chunk.right[i], chunk.top[i], chunk.left[i]}) {
+                CSVReader::appendNumber(buffer, value);
+                buffer += ',';
+            }
+            if (with_moments) {
+                for (double value : {loads[i].moment_x, loads[i].moment_y,
+                                     loads[i].center_x, loads[i].center_y}) {
+                    CSVReader::appendNumber(buffer, value);
+                    buffer += ',';
+                }
+            }
+            buffer.back() = '\n';
+        }
+        file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        
+        steps_done += chunk.size();
+        std::cout << "計算進捗: " << steps_done << " ステップ完了" << std::endl;
+        return static_cast<bool>(file);
+    }, interpolation);
+    
+    if (!completed) {
+        std::cerr << "合力の計算または書き出しに失敗しました" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// キャビテーションを考慮した求解の統計を表示する関数（--cavitation）
+void printCavitationStats(const SquareThinFilmFDM& solver) {
+    if (!solver.isCavitationEnabled()) {
+        return;
+    }
+    const SquareThinFilmFDM::CavitationStats& stats = solver.getCavitationStats();
+    std::cout << "キャビテーション: " << stats.total_solves << " ステップ, 能動集合の更新 "
+              << stats.total_iterations << " 回, 数値分解 " << stats.total_refactorizations
+              << " 回, 共役勾配法 " << stats.total_reuse_iterations << " 回, 最終ステップのキャビテーション節点 "
+              << stats.cavitated_nodes << std::endl;
+}
+
+// 増分評価で省いた求解の数を表示する関数（--incremental）
+void printIncrementalStats(const IncrementalEvaluator* incremental) {
+    if (!incremental) {
+        return;
+    }
+    const IncrementalEvaluator::Stats& stats = incremental->getStats();
+    std::cout << "増分評価: " << stats.frames << " ステップ中 " << stats.solves << " 回求解, "
+              << stats.avoided() << " 回省略（同じ境界値 " << stats.repeated << ", 許容差以内 "
+              << stats.approximated << ", 記憶の再利用 " << stats.memo_hits << "）" << std::endl;
+}
+
+// サーバーモードで SIGINT・SIGTERM を受けたことを示すフラグ（サーバーの待ち受けのたびに確認する）
+volatile std::sig_atomic_t stop_signal_received = 0;
+
+void onStopSignal(int) {
+    stop_signal_received = 1;
+}
+
+// ソルバーを常駐させて要求に答える関数（--serve）
+// mainと同じ格子は起動時に準備しておき、それ以外は最初の要求で準備する
+bool runServer(const std::string& socket_path, const std::string& operator_cache_dir, int grid_nx, int grid_ny) {
+    SolverServer server(operator_cache_dir);
+    solver_protocol::GeometryRequest geometry{grid_nx, grid_ny, 0.1, 0.13, 0.01, 1.0};
+    uint32_t handle = 0;
+    if (!server.preload(geometry, handle) || !server.listen(socket_path)) {
+        return false;
+    }
+    
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+    std::cout << "待ち受け中: " << socket_path << std::endl;
+    bool success = server.run(&stop_signal_received);
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    
+    const SolverServer::Stats& stats = server.getStats();
+    std::cout << "サーバーを終了しました: 接続 " << stats.connections << ", 要求 " << stats.requests
+              << "（合力 " << stats.force_requests << ", 圧力分布 " << stats.field_requests
+              << ", エラー " << stats.errors << "）, 格子 " << stats.geometries << std::endl;
+    return success;
+}
+
+// 計測結果を出力する（--profile, --trace）
+// mainのどの経路で終了しても、スコープを抜けるときに集計表とトレースを書き出す
+struct ProfileReport {
+    bool print_summary;
+    std::string trace_file;
+    
+    ~ProfileReport() {
+        if (print_summary) {
+            std::cout << "\n処理時間の内訳:\n";
+            instrumentation::printSummary(std::cout);
+            std::cout << std::flush;
+        }
+        if (!trace_file.empty()) {
+            if (instrumentation::writeChromeTrace(trace_file)) {
+                std::cout << "トレースを書き出しました: " << trace_file << std::endl;
+            } else {
+                std::cerr << "トレースを書き出せません: " << trace_file << std::endl;
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[]) {
+    // コマンドライン引数
+    //   --full-solve  全ステップで圧力場を解く（既定は境界値→合力オペレータ）
+    //   --threads N   並列計算のスレッド数（既定はハードウェアのスレッド数）
+    //   --batch FILE  マニフェストに記載した複数ケースを計算する
+    //   --mixed-precision  単精度のLU分解＋倍精度の反復改良で解く（分解のメモリが半分）
+    //   --moments     一次モーメント・圧力中心の列を結果に加える
+    //   --cavitation P  内部の圧力に下限 P [Pa] を課す（Reynolds境界条件、--full-solveを含む）
+    //   --incremental   圧力場を解くモードで、境界値が直前に解いたステップと同じなら解かずに結果を使う
+    //   --change-tolerance P  境界値の変化が P [Pa] 以下のステップも解かない（--incrementalを含む）
+    //   --between MODE  解かないステップの求め方（hold, linear、既定はhold、--incrementalを含む）
+    //   --grid N|NXxNY  格子点数（既定は100、NXxNYでx・y方向を個別に指定）
+    //   --chunk-rows N  境界圧力CSVをN行ずつ読みながら計算する（メモリ使用量一定）
+    //   --interp MODE 各辺の時刻のそろえ方（nearest, linear, hold、既定はnearest）
+    //   --no-cache    CSVの変換キャッシュ（*.csv.pdcol）と合力オペレータのキャッシュを使わない
+    //   --operator-cache DIR  合力オペレータをDIRにキャッシュする（既定はキャッシュしない）
+    //   --output-format FORMAT  結果の形式（csv, binary, both、既定はcsv）
+    //   --field-output FILE  各ステップの圧力分布を圧縮バイナリで書き出す（--full-solveを含む）
+    //   --field-stride N     圧力分布の空間方向の間引き間隔（既定は1）
+    //   --field-every N      圧力分布を書き出すステップ間隔（既定は1）
+    //   --field-float64      圧力分布をfloat32に量子化せずに書き出す
+    //   --serve SOCKET  ソルバーを常駐させ、Unixドメインソケットで要求に答える（PressureDistClient）
+    //   --profile     終了時に処理区間ごとの時間・分解の非ゼロ数・ピークメモリを表示する
+    //   --trace FILE  処理区間のタイムラインをChrome trace形式で書き出す（--profileを含む）
+    bool full_solve = false;
+    std::string field_output;
+    FieldWriter::Options field_options;
+    bool use_cache = true;
+    std::string operator_cache_dir;  // 空ならキャッシュしない
+    bool write_csv = true;
+    bool write_binary = false;
+    TimeIndex::Interpolation interpolation = TimeIndex::Interpolation::Nearest;
+    int num_threads = 0;
+    std::string manifest;
+    std::string serve_socket;
+    size_t chunk_rows = 0;
+    bool mixed_precision = false;
+    bool with_moments = false;
+    bool cavitation = false;
+    double cavitation_pressure = 0.0;
+    bool incremental = false;
+    double change_tolerance = 0.0;
+    IncrementalEvaluator::Fill between = IncrementalEvaluator::Fill::Hold;
+    int grid_nx = 100;
+    int grid_ny = 100;
+    bool profile = false;
+    std::string trace_file;
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (arg == "--full-solve") {
+            full_solve = true;
+        } else if (arg == "--threads" && a + 1 < argc) {
+            num_threads = std::atoi(argv[++a]);
+        } else if (arg == "--batch" && a + 1 < argc) {
+            manifest = argv[++a];
+        } else if (arg == "--serve" && a + 1 < argc) {
+            serve_socket = argv[++a];
+        } else if (arg == "--profile") {
+            profile = true;
+        } else if (arg == "--trace" && a + 1 < argc) {
+            trace_file = argv[++a];
+            profile = true;
+        } else if (arg == "--moments") {
+            with_moments = true;
+        } else if (arg == "--mixed-precision") {
+            mixed_precision = true;
+        } else if (arg == "--cavitation" && a + 1 < argc) {
+            cavitation = true;
+            cavitation_pressure = std::atof(argv[++a]);
+        } else if (arg == "--incremental") {
+            incremental = true;
+        } else if (arg == "--change-tolerance" && a + 1 < argc) {
+            incremental = true;
+            change_tolerance = std::atof(argv[++a]);
+            if (!(change_tolerance >= 0.0)) {
+                std::cerr << "許容差は0以上を指定してください: " << argv[a] << std::endl;
+                return 1;
+            }
+        } else if (arg == "--between" && a + 1 < argc) {
+            incremental = true;
+            std::string mode = argv[++a];
+            if (!IncrementalEvaluator::parseFill(mode, between)) {
+                std::cerr << "不明な補間方法: " << mode << std::endl;
+                return 1;
+            }
+        } else if (arg == "--grid" && a + 1 < argc) {
+            std::string grid = argv[++a];
+            if (!BatchRunner::parseGridSize(grid, grid_nx, grid_ny)) {
+                std::cerr << "格子点数の指定が不正です: " << grid << std::endl;
+                return 1;
+            }
+        } else if (arg == "--chunk-rows" && a + 1 < argc) {
+            chunk_rows = static_cast<size_t>(std::atol(argv[++a]));
+        } else if (arg == "--field-output" && a + 1 < argc) {
+            field_output = argv[++a];
+        } else if (arg == "--field-stride" && a + 1 < argc) {
+            field_options.spatial_stride = std::atoi(argv[++a]);
+        } else if (arg == "--field-every" && a + 1 < argc) {
+            field_options.temporal_stride = std::atoi(argv[++a]);
+        } else if (arg == "--field-float64") {
+            field_options.quantize_float32 = false;
+        } else if (arg == "--no-cache") {
+            use_cache = false;
+        } else if (arg == "--operator-cache" && a + 1 < argc) {
+            operator_cache_dir = argv[++a];
+        } else if (arg == "--output-format" && a + 1 < argc) {
+            std::string format = argv[++a];
+            write_csv = (format == "csv" || format == "both");
+            write_binary = (format == "binary" || format == "both");
+            if (!write_csv && !write_binary) {
+                std::cerr << "不明な出力形式: " << format << std::endl;
+                return 1;
+            }
+        } else if (arg == "--interp" && a + 1 < argc) {
+            std::string mode = argv[++a];
+            if (mode == "nearest") {
+                interpolation = TimeIndex::Interpolation::Nearest;
+            } else if (mode == "linear") {
+                interpolation = TimeIndex::Interpolation::Linear;
+            } else if (mode == "hold") {
+                interpolation = TimeIndex::Interpolation::Hold;
+            } else {
+                std::cerr << "不明な補間方法: " << mode << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "不明な引数: " << arg << std::endl;
+            return 1;
+        }
+    }
+    
+    // 圧力分布の出力には全ステップの求解が必要
+    if (!field_output.empty()) {
+        full_solve = true;
+    }
+    // キャビテーションを考慮すると境界値→合力が線形でないので、オペレータは使えない
+    if (cavitation) {
+        if (!manifest.empty() || with_moments) {
+            std::cerr << "--cavitation は --batch, --moments と同時に指定できません" << std::endl;
+            return 1;
+        }
+        full_solve = true;
+    }
+    // 合力オペレータでは各ステップが内積だけなので、省く求解がない
+    if (incremental && !full_solve) {
+        std::cout << "--incremental は圧力場を解くモード（--full-solve など）でのみ使います" << std::endl;
+        incremental = false;
+    }
+    if (!use_cache) {
+        operator_cache_dir.clear();
+    }
+    
+    // 計測（PRESSUREDIST_INSTRUMENTATIONなしでビルドした場合は記録されない）
+    if (profile) {
+        if (!instrumentation::kCompiledIn) {
+            std::cerr << "計測なしでビルドされています（PRESSUREDIST_INSTRUMENTATION）" << std::endl;
+        }
+        instrumentation::enable(!trace_file.empty());
+    }
+    ProfileReport profile_report{profile, trace_file};
+    
+    // バッチモード
+    if (!manifest.empty()) {
+        BatchRunner batch(num_threads);
+        batch.setOperatorCacheDirectory(operator_cache_dir);
+        batch.setInterpolation(interpolation);
+        batch.setCsvCache(use_cache);
+        batch.setOutputFormats(write_csv, write_binary);
+        if (!batch.loadManifest(manifest)) {
+            return 1;
+        }
+        if (!batch.run()) {
+            std::cerr << "一部のケースの計算に失敗しました" << std::endl;
+            return 1;
+        }
+        std::cout << "すべてのケースの計算が完了しました。" << std::endl;
+        return 0;
+    }
+    
+    // サーバーモード
+    if (!serve_socket.empty()) {
+        return runServer(serve_socket, operator_cache_dir, grid_nx, grid_ny) ? 0 : 1;
+    }
+    
     try {
         CSVReader reader;
         
+        // ストリーミングモード
+        if (chunk_rows > 0) {
+            if (write_binary) {
+                // 列指向の形式は行数が確定してから書くので逐次出力できない
+                std::cerr << "--chunk-rows ではCSV出力のみ対応しています" << std::endl;
+                return 1;
+            }
+            SquareThinFilmFDM solver(grid_nx, grid_ny, 0.1, 0.13, nullptr, 0.01, 1.0);
+            if (mixed_precision) {
+                solver.setSolverBackend(SquareThinFilmFDM::SolverBackend::MixedPrecisionLU);
+            }
+            solver.setCavitation(cavitation, cavitation_pressure);
+            std::filesystem::create_directories("results");
+            FieldWriter field_writer;
+            if (!field_output.empty() &&
+                !field_writer.open(field_output, solver.getXCoordinates(), solver.getYCoordinates(), field_options)) {
+                return 1;
+            }
+            IncrementalEvaluator incremental_evaluator(solver, change_tolerance, between, num_threads);
+            if (!calculateForceTimeSeriesStreaming(solver, chunk_rows, full_solve, num_threads, interpolation,
+                                                   field_writer.isOpen() ? &field_writer : nullptr,
+                                                   incremental ? &incremental_evaluator : nullptr,
+                                                   operator_cache_dir, with_moments, "results/pressure_force_results.csv")) {
+                return 1;
+            }
+            if (field_writer.isOpen() && !field_writer.close()) {
+                return 1;
+            }
+            printCavitationStats(solver);
+            printIncrementalStats(incremental ? &incremental_evaluator : nullptr);
+            std::cout << "すべての処理が完了しました。結果は results ディレクトリに保存されています。" << std::endl;
+            return 0;
+        }
+        
         // CSVファイルを読み込み
         std::cout << "CSVファイルを読み込み中..." << std::endl;
-        auto bottom_pressure = reader.readCSV("bottompressure.csv");
-        auto left_pressure = reader.readCSV("leftpressure.csv");
-        auto right_pressure = reader.readCSV("rightpressure.csv");
-        auto top_pressure = reader.readCSV("toppressure.csv");
+        EdgePressureSeries series = loadEdgePressureSeries(".", interpolation, use_cache);
         
         // ソルバーを初期化
-        //(int n, double side_width, double side_height,HeightFunction h_func, double viscosity, double velocity)
-        SquareThinFilmFDM solver(100, 0.1, 0.13, nullptr, 0.01, 1.0);
+        //(int nx, int ny, double side_width, double side_height,HeightFunction h_func, double viscosity, double velocity)
+        SquareThinFilmFDM solver(grid_nx, grid_ny, 0.1, 0.13, nullptr, 0.01, 1.0);
+        if (mixed_precision) {
+            solver.setSolverBackend(SquareThinFilmFDM::SolverBackend::MixedPrecisionLU);
+        }
+        solver.setCavitation(cavitation, cavitation_pressure);
         
-        // 共通の時間値を取得（bottompressureファイルから）
-        auto time_values = bottom_pressure.getUniqueValues("simulation_time");
+        // 共通の時間値（bottompressureファイルから）
+        const auto& time_values = series.time;
         
         std::cout << "時間ステップ数: " << time_values.size() << std::endl;
         
-        // 各辺の圧力値を取得
-        auto bottom_pressures = extractPressureValues(bottom_pressure, time_values);
-        auto right_pressures = extractPressureValues(right_pressure, time_values);
-        auto top_pressures = extractPressureValues(top_pressure, time_values);
-        auto left_pressures = extractPressureValues(left_pressure, time_values);
+        // 各辺の圧力値
+        const auto& bottom_pressures = series.bottom;
+        const auto& right_pressures = series.right;
+        const auto& top_pressures = series.top;
+        const auto& left_pressures = series.left;
         
         // 出力ディレクトリの作成
         std::filesystem::create_directories("results");
         
+        // 圧力分布の出力（書き込みは別スレッドで行う）
+        FieldWriter field_writer;
+        if (!field_output.empty()) {
+            if (!field_writer.open(field_output, solver.getXCoordinates(), solver.getYCoordinates(), field_options)) {
+                return 1;
+            }
+        }
+        
         // 合力の時系列計算
         std::cout << "calculating forces..." << std::endl;
-        auto forces = calculateForceTimeSeries(
-            solver,
-            time_values,
-            bottom_pressures,
-            right_pressures,
-            top_pressures,
-            left_pressures
-        );
+        std::vector<double> forces;
+        IncrementalEvaluator incremental_evaluator(solver, change_tolerance, between, num_threads);
+        if (full_solve) {
+            forces = calculateForceTimeSeriesFullSolve(
+                solver,
+                series,
+                num_threads,
+                field_writer.isOpen() ? &field_writer : nullptr,
+                incremental ? &incremental_evaluator : nullptr
+            );
+        } else {
+            forces = calculateForceTimeSeries(
+                solver,
+                time_values,
+                bottom_pressures,
+                right_pressures,
+                top_pressures,
+                left_pressures,
+                operator_cache_dir
+            );
+        }
+        if (forces.size() != time_values.size()) {
+            std::cerr << "合力の計算に失敗しました" << std::endl;
+            return 1;
+        }
         
         // 結果をCSVファイルに保存
         CSVReader::CSVData result_data;
@@ -152,7 +651,45 @@ int main() {
         result_data.columns["top_pressure"] = top_pressures;
         result_data.columns["left_pressure"] = left_pressures;
         
-        reader.writeCSV("results/pressure_force_results.csv", result_data);
+        // 一次モーメント・圧力中心（合力オペレータで境界値から直接求める）
+        if (with_moments) {
+            std::vector<SquareThinFilmFDM::LoadIntegrals> loads;
+            if (!calculateLoadTimeSeries(solver, series, loads)) {
+                return 1;
+            }
+            const std::pair<const char*, double SquareThinFilmFDM::LoadIntegrals::*> load_columns[] = {
+                {"moment_x", &SquareThinFilmFDM::LoadIntegrals::moment_x},
+                {"moment_y", &SquareThinFilmFDM::LoadIntegrals::moment_y},
+                {"center_x", &SquareThinFilmFDM::LoadIntegrals::center_x},
+                {"center_y", &SquareThinFilmFDM::LoadIntegrals::center_y}
+            };
+            for (const auto& column : load_columns) {
+                std::vector<double>& values = result_data.columns[column.first];
+                values.reserve(loads.size());
+                for (const auto& load : loads) {
+                    values.push_back(load.*column.second);
+                }
+                result_data.headers.push_back(column.first);
+            }
+        }
+        
+        if (write_csv) {
+            reader.writeCSV("results/pressure_force_results.csv", result_data);
+        }
+        if (write_binary) {
+            ColumnarFile::write("results/pressure_force_results.pdcol", result_data);
+        }
+        
+        if (field_writer.isOpen()) {
+            if (!field_writer.close()) {
+                return 1;
+            }
+            std::cout << "圧力分布: " << field_writer.framesWritten() << " フレーム, "
+                      << field_writer.bytesWritten() << " バイト（無圧縮比 "
+                      << field_writer.compressionRatio() << "）" << std::endl;
+        }
+        printCavitationStats(solver);
+        printIncrementalStats(incremental ? &incremental_evaluator : nullptr);
         
         std::cout << "すべての処理が完了しました。結果は results ディレクトリに保存されています。" << std::endl;
         
@@ -0,0 +1,175 @@
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : ptr(nullptr), length(0), released(0), file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr) {}
+
+MappedFile::MappedFile(const std::string& filename) : MappedFile() {
+    file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size)) {
+        close();
+        throw std::runtime_error("Cannot get file size: " + filename);
+    }
+    length = static_cast<size_t>(file_size.QuadPart);
+    if (length == 0) {
+        return;
+    }
+
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle) {
+        close();
+        throw std::runtime_error("Cannot map file: " + filename);
+    }
+    ptr = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (!ptr) {
+        close();
+        throw std::runtime_error("Cannot map file: " + filename);
+    }
+}
+
+void MappedFile::releaseBefore(const char* pos) {
+    // 読み取り専用のビューは必要に応じてOSが破棄するので何もしない
+    (void)pos;
+}
+
+void MappedFile::close() {
+    if (ptr) {
+        UnmapViewOfFile(ptr);
+    }
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_handle);
+    }
+    ptr = nullptr;
+    length = 0;
+    released = 0;
+    file_handle = INVALID_HANDLE_VALUE;
+    mapping_handle = nullptr;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : ptr(other.ptr), length(other.length), released(other.released),
+      file_handle(other.file_handle), mapping_handle(other.mapping_handle) {
+    other.ptr = nullptr;
+    other.length = 0;
+    other.released = 0;
+    other.file_handle = INVALID_HANDLE_VALUE;
+    other.mapping_handle = nullptr;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(ptr, other.ptr);
+        std::swap(length, other.length);
+        std::swap(released, other.released);
+        std::swap(file_handle, other.file_handle);
+        std::swap(mapping_handle, other.mapping_handle);
+    }
+    return *this;
+}
+
+#else
+
+MappedFile::MappedFile() : ptr(nullptr), length(0), released(0), fd(-1) {}
+
+MappedFile::MappedFile(const std::string& filename) : MappedFile() {
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + filename);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        close();
+        throw std::runtime_error("Cannot get file size: " + filename);
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0) {
+        return;
+    }
+
+    void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        close();
+        throw std::runtime_error("Cannot map file: " + filename);
+    }
+    ptr = static_cast<const char*>(addr);
+
+    // 先頭から順に読むのでカーネルに先読みを促す
+    ::madvise(addr, length, MADV_SEQUENTIAL);
+}
+
+void MappedFile::releaseBefore(const char* pos) {
+    if (!ptr || pos <= ptr) {
+        return;
+    }
+    size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t offset = std::min(static_cast<size_t>(pos - ptr), length) / page * page;
+    if (offset > released) {
+        ::madvise(const_cast<char*>(ptr) + released, offset - released, MADV_DONTNEED);
+        released = offset;
+    }
+}
+
+void MappedFile::close() {
+    if (ptr) {
+        ::munmap(const_cast<char*>(ptr), length);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    ptr = nullptr;
+    length = 0;
+    released = 0;
+    fd = -1;
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : ptr(other.ptr), length(other.length), released(other.released), fd(other.fd) {
+    other.ptr = nullptr;
+    other.length = 0;
+    other.released = 0;
+    other.fd = -1;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(ptr, other.ptr);
+        std::swap(length, other.length);
+        std::swap(released, other.released);
+        std::swap(fd, other.fd);
+    }
+    return *this;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
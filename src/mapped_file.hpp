@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * 読み取り専用のメモリマップドファイル
+ *
+ * ファイル全体をアドレス空間に割り当て、コピーせずに先頭からの文字列として参照する。
+ * 空ファイルは割り当てずに size() == 0 として扱う。
+ */
+class MappedFile {
+private:
+    const char* ptr;
+    size_t length;
+    size_t released;      // 解放済みの先頭からのバイト数
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#else
+    int fd;
+#endif
+
+public:
+    MappedFile();
+
+    /**
+     * ファイルを割り当てる（失敗した場合は例外を送出）
+     * @param filename ファイル名
+     */
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    const char* data() const { return ptr; }
+    size_t size() const { return length; }
+    const char* begin() const { return ptr; }
+    const char* end() const { return ptr + length; }
+
+    /**
+     * 先頭から pos までを今後読まないことをOSに伝え、常駐ページを解放する
+     * （ファイルの内容は変わらず、再度読めばディスクから読み直される）
+     * @param pos 割り当て領域内の位置
+     */
+    void releaseBefore(const char* pos);
+
+private:
+    void close();
+};
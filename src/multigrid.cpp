@@ -0,0 +1,237 @@
+#include "multigrid.hpp"
+#include <iostream>
+
+GeometricMultigrid::GeometricMultigrid()
+    : cycle(Cycle::V), tolerance(1e-10), max_cycles(100), pre_sweeps(2), post_sweeps(2),
+      last_iterations(0), last_residual(0.0) {}
+
+void GeometricMultigrid::coarsenAxis(const Vector& fine, Vector& coarse, std::vector<int>& selected,
+                                     std::vector<int>& coarse_index, std::vector<double>& weight) {
+    int nf = static_cast<int>(fine.size());
+
+    // 1つおきに節点を残し、端の節点は必ず含める
+    selected.clear();
+    for (int j = 0; j < nf; j += 2) {
+        selected.push_back(j);
+    }
+    if (selected.back() != nf - 1) {
+        selected.push_back(nf - 1);
+    }
+
+    int nc = static_cast<int>(selected.size());
+    coarse.resize(nc);
+    for (int c = 0; c < nc; ++c) {
+        coarse(c) = fine(selected[c]);
+    }
+
+    // 細格子の各節点を含む粗格子区間 [c, c+1] と節点cに対する線形補間の重み
+    coarse_index.assign(nf, 0);
+    weight.assign(nf, 0.0);
+    int c = 0;
+    for (int j = 0; j < nf; ++j) {
+        while (c < nc - 2 && selected[c + 1] <= j) {
+            ++c;
+        }
+        coarse_index[j] = c;
+        weight[j] = (coarse(c + 1) - fine(j)) / (coarse(c + 1) - coarse(c));
+    }
+}
+
+bool GeometricMultigrid::setup(const Matrix& k, const Vector& xs, const Vector& ys) {
+    levels.clear();
+
+    Level fine;
+    fine.k = k;
+    fine.xs = xs;
+    fine.ys = ys;
+    fine.stencil.build(fine.k, fine.xs, fine.ys);
+    levels.push_back(std::move(fine));
+
+    // 内部点が各方向3点以上ある間は粗くする
+    while (levels.back().stencil.cols() >= 3 && levels.back().stencil.rows() >= 3) {
+        Level& f = levels.back();
+        Level coarse;
+
+        std::vector<int> selected_x;
+        std::vector<int> selected_y;
+        coarsenAxis(f.xs, coarse.xs, selected_x, f.coarse_x, f.weight_x);
+        coarsenAxis(f.ys, coarse.ys, selected_y, f.coarse_y, f.weight_y);
+
+        // 係数の制限（内部節点は9点の全加重平均、境界節点は注入）
+        int nyc = static_cast<int>(coarse.ys.size());
+        int nxc = static_cast<int>(coarse.xs.size());
+        int nyf = static_cast<int>(f.ys.size());
+        int nxf = static_cast<int>(f.xs.size());
+        coarse.k.resize(nyc, nxc);
+        for (int I = 0; I < nyc; ++I) {
+            for (int J = 0; J < nxc; ++J) {
+                int i = selected_y[I];
+                int j = selected_x[J];
+                if (i > 0 && i < nyf - 1 && j > 0 && j < nxf - 1) {
+                    coarse.k(I, J) = (4.0 * f.k(i, j)
+                                    + 2.0 * (f.k(i + 1, j) + f.k(i - 1, j) + f.k(i, j + 1) + f.k(i, j - 1))
+                                    + f.k(i + 1, j + 1) + f.k(i + 1, j - 1)
+                                    + f.k(i - 1, j + 1) + f.k(i - 1, j - 1)) / 16.0;
+                } else {
+                    coarse.k(I, J) = f.k(i, j);
+                }
+            }
+        }
+
+        coarse.stencil.build(coarse.k, coarse.xs, coarse.ys);
+        levels.push_back(std::move(coarse));
+    }
+
+    // 作業領域の確保
+    for (auto& level : levels) {
+        level.b = Vector::Zero(level.stencil.size());
+        level.x = Vector::Zero(level.stencil.size());
+        level.r = Vector::Zero(level.stencil.size());
+    }
+
+    // 最粗格子は直接法で解く
+    coarse_solver.compute(levels.back().stencil.toSparse());
+    if (coarse_solver.info() != Eigen::Success) {
+        std::cerr << "マルチグリッドの最粗格子の分解に失敗しました" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void GeometricMultigrid::restrictResidual(int level) {
+    Level& f = levels[level];
+    Level& c = levels[level + 1];
+
+    f.stencil.residual(f.b, f.x, f.r);
+
+    int mxf = f.stencil.cols();
+    int myf = f.stencil.rows();
+    int mxc = c.stencil.cols();
+    int myc = c.stencil.rows();
+
+    // 補間の転置で残差を集め、重みの総和で正規化する（等間隔では全加重平均）
+    c.b.setZero();
+    Vector weight_sum_x = Vector::Zero(mxc + 2);
+    Vector weight_sum_y = Vector::Zero(myc + 2);
+    for (int j = 0; j < mxf + 2; ++j) {
+        weight_sum_x(f.coarse_x[j]) += f.weight_x[j];
+        weight_sum_x(f.coarse_x[j] + 1) += 1.0 - f.weight_x[j];
+    }
+    for (int i = 0; i < myf + 2; ++i) {
+        weight_sum_y(f.coarse_y[i]) += f.weight_y[i];
+        weight_sum_y(f.coarse_y[i] + 1) += 1.0 - f.weight_y[i];
+    }
+
+    for (int i = 1; i <= myf; ++i) {
+        int cy = f.coarse_y[i];
+        double wy[2] = {f.weight_y[i], 1.0 - f.weight_y[i]};
+        for (int j = 1; j <= mxf; ++j) {
+            int cx = f.coarse_x[j];
+            double wx[2] = {f.weight_x[j], 1.0 - f.weight_x[j]};
+            double r = f.r((i - 1) * mxf + (j - 1));
+            for (int a = 0; a < 2; ++a) {
+                int I = cy + a;
+                if (I < 1 || I > myc || wy[a] == 0.0) continue;
+                for (int b = 0; b < 2; ++b) {
+                    int J = cx + b;
+                    if (J < 1 || J > mxc || wx[b] == 0.0) continue;
+                    c.b((I - 1) * mxc + (J - 1)) += wy[a] * wx[b] * r;
+                }
+            }
+        }
+    }
+
+    for (int I = 1; I <= myc; ++I) {
+        for (int J = 1; J <= mxc; ++J) {
+            c.b((I - 1) * mxc + (J - 1)) /= weight_sum_y(I) * weight_sum_x(J);
+        }
+    }
+
+    c.x.setZero();
+}
+
+void GeometricMultigrid::prolongateCorrection(int level) {
+    Level& f = levels[level];
+    const Level& c = levels[level + 1];
+
+    int mxf = f.stencil.cols();
+    int myf = f.stencil.rows();
+    int mxc = c.stencil.cols();
+    int myc = c.stencil.rows();
+
+    // 粗格子の補正を双線形補間して加える（粗格子の境界では補正はゼロ）
+    for (int i = 1; i <= myf; ++i) {
+        int cy = f.coarse_y[i];
+        double wy[2] = {f.weight_y[i], 1.0 - f.weight_y[i]};
+        for (int j = 1; j <= mxf; ++j) {
+            int cx = f.coarse_x[j];
+            double wx[2] = {f.weight_x[j], 1.0 - f.weight_x[j]};
+            double correction = 0.0;
+            for (int a = 0; a < 2; ++a) {
+                int I = cy + a;
+                if (I < 1 || I > myc || wy[a] == 0.0) continue;
+                for (int b = 0; b < 2; ++b) {
+                    int J = cx + b;
+                    if (J < 1 || J > mxc || wx[b] == 0.0) continue;
+                    correction += wy[a] * wx[b] * c.x((I - 1) * mxc + (J - 1));
+                }
+            }
+            f.x((i - 1) * mxf + (j - 1)) += correction;
+        }
+    }
+}
+
+void GeometricMultigrid::runCycle(int level) {
+    Level& current = levels[level];
+
+    if (level == static_cast<int>(levels.size()) - 1) {
+        current.x = coarse_solver.solve(current.b);
+        return;
+    }
+
+    current.stencil.smoothRedBlack(current.b, current.x, pre_sweeps);
+
+    restrictResidual(level);
+    int recursions = (cycle == Cycle::W) ? 2 : 1;
+    for (int k = 0; k < recursions; ++k) {
+        runCycle(level + 1);
+    }
+    prolongateCorrection(level);
+
+    current.stencil.smoothRedBlack(current.b, current.x, post_sweeps);
+}
+
+bool GeometricMultigrid::solve(const Vector& b, Vector& x) {
+    Level& fine = levels.front();
+
+    double b_norm = b.norm();
+    if (b_norm == 0.0) {
+        x = Vector::Zero(b.size());
+        last_iterations = 0;
+        last_residual = 0.0;
+        return true;
+    }
+
+    fine.b = b;
+    if (x.size() == b.size()) {
+        fine.x = x;
+    } else {
+        fine.x.setZero();
+    }
+
+    // 初期値の残差で既に収束していればサイクルを回さない
+    fine.stencil.residual(fine.b, fine.x, fine.r);
+    last_residual = fine.r.norm() / b_norm;
+    last_iterations = 0;
+
+    while (last_residual > tolerance && last_iterations < max_cycles) {
+        runCycle(0);
+        fine.stencil.residual(fine.b, fine.x, fine.r);
+        last_residual = fine.r.norm() / b_norm;
+        last_iterations++;
+    }
+
+    x = fine.x;
+    return last_residual <= tolerance;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Eigen/Sparse>
+#include <vector>
+#include "reynolds_stencil.hpp"
+
+/**
+ * 構造格子上の幾何マルチグリッド法
+ *
+ * 各レベルで節点を1つおきに間引き（端の節点は必ず残す）、係数 h³/12μ を
+ * 粗格子に制限して同じ面平均の離散化で再構築する。平滑化は赤黒Gauss-Seidel法、
+ * 格子間の転送は双線形補間とその転置（重み正規化）を用いる。最粗格子は疎行列LUで解く。
+ */
+class GeometricMultigrid {
+public:
+    using Matrix = Eigen::MatrixXd;
+    using SparseMatrix = Eigen::SparseMatrix<double>;
+    using Vector = Eigen::VectorXd;
+
+    /**
+     * サイクルの種類
+     */
+    enum class Cycle {
+        V,   // Vサイクル（各レベルで1回再帰）
+        W    // Wサイクル（各レベルで2回再帰）
+    };
+
+private:
+    struct Level {
+        ReynoldsStencil stencil;     // このレベルの演算子
+        Vector xs;                   // x方向の節点座標
+        Vector ys;                   // y方向の節点座標
+        Matrix k;                    // 節点の係数 h³/12μ
+
+        // 1つ粗いレベルへの転送（細格子の各節点が属する粗格子区間と左側の重み）
+        std::vector<int> coarse_x;
+        std::vector<double> weight_x;
+        std::vector<int> coarse_y;
+        std::vector<double> weight_y;
+
+        // 作業領域
+        Vector b;
+        Vector x;
+        Vector r;
+    };
+
+    std::vector<Level> levels;
+    Eigen::SparseLU<SparseMatrix> coarse_solver;  // 最粗格子の直接法
+
+    Cycle cycle;
+    double tolerance;        // 相対残差の収束判定値
+    int max_cycles;          // 最大サイクル数
+    int pre_sweeps;          // 前平滑化の回数
+    int post_sweeps;         // 後平滑化の回数
+
+    int last_iterations;     // 直前の求解のサイクル数
+    double last_residual;    // 直前の求解の相対残差
+
+public:
+    GeometricMultigrid();
+
+    /**
+     * 格子階層を構築する
+     * @param k 節点の係数 h³/12μ（境界を含む ys.size() × xs.size()）
+     * @param xs x方向の節点座標
+     * @param ys y方向の節点座標
+     * @return 構築が成功したかどうか
+     */
+    bool setup(const Matrix& k, const Vector& xs, const Vector& ys);
+
+    void setCycle(Cycle c) { cycle = c; }
+    void setTolerance(double tol) { tolerance = tol; }
+    void setMaxCycles(int cycles) { max_cycles = cycles; }
+    void setSmoothingSweeps(int pre, int post) { pre_sweeps = pre; post_sweeps = post; }
+
+    /**
+     * A x = b を解く
+     * @param b 右辺ベクトル
+     * @param x 初期値（サイズが合えばウォームスタートに使用）、解で上書き
+     * @return 収束したかどうか
+     */
+    bool solve(const Vector& b, Vector& x);
+
+    int numLevels() const { return static_cast<int>(levels.size()); }
+    int iterations() const { return last_iterations; }
+    double relativeResidual() const { return last_residual; }
+
+private:
+    void runCycle(int level);
+    void restrictResidual(int level);
+    void prolongateCorrection(int level);
+
+    /**
+     * 節点を1つおきに間引いた粗格子の座標と転送重みを求める
+     */
+    static void coarsenAxis(const Vector& fine, Vector& coarse, std::vector<int>& selected,
+                            std::vector<int>& coarse_index, std::vector<double>& weight);
+};
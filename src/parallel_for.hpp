@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * スレッド数の既定値（0以下ならハードウェアのスレッド数）
+ */
+inline int resolveThreadCount(int num_threads) {
+    if (num_threads > 0) {
+        return num_threads;
+    }
+    unsigned int hw = std::thread::hardware_concurrency();
+    return hw > 0 ? static_cast<int>(hw) : 1;
+}
+
+/**
+ * [0, count) をチャンクに分けて複数スレッドで処理する
+ *
+ * 各スレッドは共有カウンタから次のチャンクを取り出すので、ステップごとの
+ * 計算時間にばらつきがあっても負荷が偏らない。
+ * @param count 要素数
+ * @param num_threads スレッド数（0以下ならハードウェアのスレッド数）
+ * @param chunk_size 一度に取り出す要素数
+ * @param body body(begin, end, thread_id) の形で呼ばれる処理
+ */
+template<typename Body>
+void parallelFor(size_t count, int num_threads, size_t chunk_size, Body&& body) {
+    int threads = resolveThreadCount(num_threads);
+    chunk_size = std::max<size_t>(chunk_size, 1);
+    size_t num_chunks = (count + chunk_size - 1) / chunk_size;
+    threads = static_cast<int>(std::min<size_t>(threads, std::max<size_t>(num_chunks, 1)));
+
+    std::atomic<size_t> next_chunk(0);
+    auto worker = [&](int thread_id) {
+        while (true) {
+            size_t chunk = next_chunk.fetch_add(1);
+            if (chunk >= num_chunks) {
+                break;
+            }
+            size_t begin = chunk * chunk_size;
+            size_t end = std::min(begin + chunk_size, count);
+            body(begin, end, thread_id);
+        }
+    };
+
+    if (threads <= 1) {
+        worker(0);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (int t = 1; t < threads; ++t) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
@@ -1,105 +1,447 @@
 #include "pressuredistsolver.hpp"
+#include "mapped_file.hpp"
+#include "instrumentation.hpp"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
 
 SquareThinFilmFDM::SquareThinFilmFDM(int n, double side_width, double side_height,
                                    HeightFunction h_func, double viscosity, double velocity)
-    : n(n), width(side_width), height(side_height),
-      viscosity(viscosity), velocity(velocity), matrix_factorized(false) {
+    : SquareThinFilmFDM(n, n, side_width, side_height, h_func, viscosity, velocity) {}
+
+SquareThinFilmFDM::SquareThinFilmFDM(int nx, int ny, double side_width, double side_height,
+                                   HeightFunction h_func, double viscosity, double velocity)
+    : nx(nx), ny(ny), width(side_width), height(side_height),
+      viscosity(viscosity), velocity(velocity), gradient_scheme(GradientScheme::Central),
+      matrix_factorized(false), pattern_analyzed(false), operator_scale(1.0),
+      requested_backend(SolverBackend::Auto), active_backend(SolverBackend::Auto),
+      iterative_tolerance(1e-10), max_iterations(100),
+      preconditioner(Preconditioner::IncompleteCholesky), last_solve_stats{0, 0.0},
+      cavitation_enabled(false), cavitation_pressure(0.0), cavitation_matrix_ready(false),
+      cavitation_pattern_analyzed(false), cavitation_factorized(false),
+      cavitation_reuse_budget(0), cavitation_reuse_spent(0),
+      operator_built(false) {
     
     // 格子間隔
-    dx = side_width / (n - 1);
-    dy = side_height / (n - 1);
+    dx = side_width / (nx - 1);
+    dy = side_height / (ny - 1);
     
     // 座標の初期化
-    x = Vector(n);
-    y = Vector(n);
-    for (int i = 0; i < n; ++i) {
-        x(i) = i * dx;
+    x = Vector(nx);
+    y = Vector(ny);
+    for (int j = 0; j < nx; ++j) {
+        x(j) = j * dx;
+    }
+    for (int i = 0; i < ny; ++i) {
         y(i) = i * dy;
     }
     
-    // 圧力場の初期化
-    P = Matrix::Zero(n, n);
+    // 圧力場の初期化（行がy方向、列がx方向）
+    P = Matrix::Zero(ny, nx);
     
     // 膜厚の初期化
     initializeHeight(h_func);
+    dhdt = Matrix::Zero(ny, nx);
+    
+    // 台形則の面積重み
+    initializeAreaWeights();
+    
+    // 係数キャッシュの構築
+    updateCoefficientCache();
 }
 
 void SquareThinFilmFDM::initializeHeight(HeightFunction h_func) {
-    h = Matrix(n, n);
+    h = Matrix(ny, nx);
     
     if (h_func == nullptr) {
         // デフォルトは一様膜厚 (1mm)
         h.setConstant(0.001);
     } else {
         // 指定された関数で膜厚を計算
-        for (int i = 0; i < n; ++i) {
-            for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < ny; ++i) {
+            for (int j = 0; j < nx; ++j) {
                 h(i, j) = h_func(x(j), y(i));
             }
         }
     }
 }
 
+void SquareThinFilmFDM::updateCoefficientCache() {
+    // 係数の計算（膜厚・粘度が変わったときのみ）
+    h3_12mu = h.array().pow(3) / (12.0 * viscosity);
+    
+    // 境界に隣接する内部節点から境界節点への結合係数
+    int mx = nx - 2;
+    int my = ny - 2;
+    coupling_left.resize(my);
+    coupling_right.resize(my);
+    coupling_bottom.resize(mx);
+    coupling_top.resize(mx);
+    for (int k = 1; k < ny - 1; ++k) {
+        coupling_left(k - 1) = 0.5 * (h3_12mu(k, 1) + h3_12mu(k, 0)) / (dx * dx);
+        coupling_right(k - 1) = 0.5 * (h3_12mu(k, nx-2) + h3_12mu(k, nx-1)) / (dx * dx);
+    }
+    for (int k = 1; k < nx - 1; ++k) {
+        coupling_bottom(k - 1) = 0.5 * (h3_12mu(1, k) + h3_12mu(0, k)) / (dy * dy);
+        coupling_top(k - 1) = 0.5 * (h3_12mu(ny-2, k) + h3_12mu(ny-1, k)) / (dy * dy);
+    }
+    
+    // すべり速度・スクイーズによる項（境界値に依存しない右辺）
+    // 係数をh³/12μとしたReynolds方程式 ∇・(h³/12μ ∇p) = (U/2) ∂h/∂x + ∂h/∂t の右辺
+    slip_rhs.resize(mx * my);
+    int idx = 0;
+    for (int i = 1; i < ny - 1; ++i) {
+        for (int j = 1; j < nx - 1; ++j) {
+            // 膜厚勾配の計算
+            double dhdx;
+            if (gradient_scheme == GradientScheme::Central) {
+                dhdx = (h(i, j + 1) - h(i, j - 1)) / (2.0 * dx);
+            } else if (velocity >= 0.0) {
+                dhdx = (h(i, j) - h(i, j - 1)) / dx;    // 後退差分（x方向正のすべり）
+            } else {
+                dhdx = (h(i, j + 1) - h(i, j)) / dx;    // 前進差分（x方向負のすべり）
+            }
+            
+            slip_rhs(idx) = 0.5 * velocity * dhdx + dhdt(i, j);
+            idx++;
+        }
+    }
+    
+    // 毎ステップ使う右辺ベクトル（境界に隣接しない成分はすべり項のまま変わらない）
+    rhs_buffer = slip_rhs;
+    solution_buffer = Vector::Zero(mx * my);
+}
+
+void SquareThinFilmFDM::setViscosity(double mu) {
+    // 係数 h³/12μ は一様に μ_old/μ 倍（すべり項・スクイーズ項はμに依存しない）
+    double ratio = viscosity / mu;
+    viscosity = mu;
+    updateCoefficientCache();
+    
+    if (matrix_factorized) {
+        operator_scale *= ratio;
+    }
+    
+    // 随伴解は 1/ratio 倍、境界の重みは不変（キャッシュから読んだオペレータも同様）
+    if (operator_built) {
+        for (auto& functional : edge_functionals) {
+            functional.adjoint /= ratio;
+        }
+        updateFunctionalOffsets();
+    }
+}
+
+void SquareThinFilmFDM::setVelocity(double u) {
+    velocity = u;
+    updateCoefficientCache();
+    
+    // 随伴解は速度に依存しないので、合力オペレータは定数項のみ更新する
+    if (operator_built) {
+        updateFunctionalOffsets();
+    }
+}
+
+void SquareThinFilmFDM::setGradientScheme(GradientScheme scheme) {
+    gradient_scheme = scheme;
+    updateCoefficientCache();
+    
+    if (operator_built) {
+        updateFunctionalOffsets();
+    }
+}
+
 void SquareThinFilmFDM::setEdgeBoundary(double p_bottom, double p_right, 
                                        double p_top, double p_left) {
+    fillEdgeBoundary(P, p_bottom, p_right, p_top, p_left);
+}
+
+void SquareThinFilmFDM::setSolverBackend(SolverBackend backend) {
+    requested_backend = backend;
+    matrix_factorized = false;
+    pattern_analyzed = false;
+    operator_built = false;
+}
+
+void SquareThinFilmFDM::setCavitation(bool enabled, double pressure) {
+    cavitation_enabled = enabled;
+    cavitation_pressure = pressure;
+    
+    // 能動集合は前の設定のものを使わない（分解した K_cav はそのまま再利用できる）
+    active_set.clear();
+    cavitation_stats = CavitationStats();
+    
+    // 境界値→合力の関係が非線形になるので、オペレータは使えない
+    if (enabled) {
+        operator_built = false;
+    }
+}
+
+bool SquareThinFilmFDM::setUniformGap(double gap, double dt) {
+    // 一様膜厚から一様膜厚への変化は係数が (gap/h)³ 倍になるだけなので
+    // 分解はそのままで解をスケーリングする
+    if (!matrix_factorized || !hasUniformHeight()) {
+        return setFilmThickness(Matrix::Constant(ny, nx, gap), dt);
+    }
+    
+    double h_old = h(0, 0);
+    double ratio = std::pow(gap / h_old, 3);
+    
+    dhdt.setConstant(dt > 0.0 ? (gap - h_old) / dt : 0.0);
+    h.setConstant(gap);
+    updateCoefficientCache();
+    operator_scale *= ratio;
+    
+    // 随伴解は 1/ratio 倍、境界の重みは不変
+    if (operator_built) {
+        for (auto& functional : edge_functionals) {
+            functional.adjoint /= ratio;
+        }
+        updateFunctionalOffsets();
+    }
+    
+    return true;
+}
+
+bool SquareThinFilmFDM::setFilmThickness(const Matrix& h_new, double dt) {
+    if (h_new.rows() != ny || h_new.cols() != nx) {
+        std::cerr << "膜厚分布のサイズが格子と一致しません" << std::endl;
+        return false;
+    }
+    
+    // スクイーズ項 ∂h/∂t（dt <= 0 なら静止膜として扱う）
+    if (dt > 0.0) {
+        dhdt = (h_new - h) / dt;
+    } else {
+        dhdt.setZero();
+    }
+    h = h_new;
+    updateCoefficientCache();
+    
+    if (!matrix_factorized) {
+        // キャッシュから読んだオペレータは古い膜厚のもの
+        operator_built = false;
+        return true;
+    }
+    
+    // 疎行列の非零パターンは膜厚によらないので、記号分解を再利用して数値分解のみ行う
+    bool rebuild_operator = operator_built;
+    if (!buildAndFactorizeMatrix()) {
+        return false;
+    }
+    if (rebuild_operator) {
+        return buildForceOperator();
+    }
+    
+    return true;
+}
+
+void SquareThinFilmFDM::setPreconditioner(Preconditioner pc) {
+    preconditioner = pc;
+    if (active_backend == SolverBackend::ConjugateGradient) {
+        matrix_factorized = false;
+        operator_built = false;
+    }
+}
+
+void SquareThinFilmFDM::setIterativeTolerance(double tolerance, int max_iter) {
+    iterative_tolerance = tolerance;
+    max_iterations = max_iter;
+    multigrid.setTolerance(tolerance);
+    multigrid.setMaxCycles(max_iter);
+    cg_jacobi.setTolerance(tolerance);
+    cg_jacobi.setMaxIterations(max_iter);
+    cg_ichol.setTolerance(tolerance);
+    cg_ichol.setMaxIterations(max_iter);
+    cg_matrix_free.setTolerance(tolerance);
+    cg_matrix_free.setMaxIterations(max_iter);
+}
+
+bool SquareThinFilmFDM::hasUniformHeight() const {
+    double h_max = h.maxCoeff();
+    double h_min = h.minCoeff();
+    return (h_max - h_min) <= 1e-12 * std::abs(h_max);
+}
+
+void SquareThinFilmFDM::fillEdgeBoundary(Matrix& field, double p_bottom, double p_right,
+                                        double p_top, double p_left) const {
     // 各辺に異なる圧力を設定
-    P.row(0).setConstant(p_bottom);      // 下辺
-    P.row(n-1).setConstant(p_top);       // 上辺
-    P.col(0).setConstant(p_left);        // 左辺
-    P.col(n-1).setConstant(p_right);     // 右辺
+    field.row(0).setConstant(p_bottom);      // 下辺
+    field.row(ny-1).setConstant(p_top);      // 上辺
+    field.col(0).setConstant(p_left);        // 左辺
+    field.col(nx-1).setConstant(p_right);    // 右辺
     
     // 角の処理（平均値を使用）
-    P(0, 0) = (p_bottom + p_left) / 2.0;     // 左下
-    P(0, n-1) = (p_bottom + p_right) / 2.0;  // 右下
-    P(n-1, 0) = (p_top + p_left) / 2.0;      // 左上
-    P(n-1, n-1) = (p_top + p_right) / 2.0;   // 右上
+    field(0, 0) = (p_bottom + p_left) / 2.0;         // 左下
+    field(0, nx-1) = (p_bottom + p_right) / 2.0;     // 右下
+    field(ny-1, 0) = (p_top + p_left) / 2.0;         // 左上
+    field(ny-1, nx-1) = (p_top + p_right) / 2.0;     // 右上
+}
+
+void SquareThinFilmFDM::setEdgeProfiles(const Vector& bottom, const Vector& right,
+                                        const Vector& top, const Vector& left) {
+    // 各辺に節点ごとの圧力を設定
+    P.row(0) = bottom.transpose();       // 下辺
+    P.row(ny-1) = top.transpose();       // 上辺
+    P.col(0) = left;                     // 左辺
+    P.col(nx-1) = right;                 // 右辺
+    
+    // 角の処理（setEdgeBoundaryと同様に平均値を使用）
+    P(0, 0) = (bottom(0) + left(0)) / 2.0;              // 左下
+    P(0, nx-1) = (bottom(nx-1) + right(0)) / 2.0;       // 右下
+    P(ny-1, 0) = (top(0) + left(ny-1)) / 2.0;           // 左上
+    P(ny-1, nx-1) = (top(nx-1) + right(ny-1)) / 2.0;    // 右上
+}
+
+void SquareThinFilmFDM::initializeAreaWeights() {
+    // 各方向の台形則の重み（節点(i, j)の面積重みは weight_y(i) × weight_x(j)）
+    weight_x = Vector::Constant(nx, dx);
+    weight_x(0) *= 0.5;
+    weight_x(nx - 1) *= 0.5;
+    weight_y = Vector::Constant(ny, dy);
+    weight_y(0) *= 0.5;
+    weight_y(ny - 1) *= 0.5;
+    moment_weight_x = weight_x.cwiseProduct(x);
+    moment_weight_y = weight_y.cwiseProduct(y);
+    
+    // 内部節点の面積重み
+    interior_area_weight.resize((nx - 2) * (ny - 2));
+    int idx = 0;
+    for (int i = 1; i < ny - 1; ++i) {
+        for (int j = 1; j < nx - 1; ++j) {
+            interior_area_weight(idx) = nodeAreaWeight(i, j);
+            idx++;
+        }
+    }
+    
+    // 各辺に単位圧力を与えたときの境界節点の台形則による寄与（角は半分ずつ）
+    boundary_area_sum.setZero();
+    for (int e = 0; e < 4; ++e) {
+        Eigen::Vector4d unit = Eigen::Vector4d::Unit(e);
+        Matrix unit_field = Matrix::Zero(ny, nx);
+        fillEdgeBoundary(unit_field, unit(0), unit(1), unit(2), unit(3));
+        for (int k = 0; k < nx; ++k) {
+            boundary_area_sum(e) += unit_field(0, k) * nodeAreaWeight(0, k)
+                                  + unit_field(ny-1, k) * nodeAreaWeight(ny-1, k);
+        }
+        for (int k = 1; k < ny - 1; ++k) {
+            boundary_area_sum(e) += unit_field(k, 0) * nodeAreaWeight(k, 0)
+                                  + unit_field(k, nx-1) * nodeAreaWeight(k, nx-1);
+        }
+    }
+}
+
+double SquareThinFilmFDM::nodeAreaWeight(int i, int j) const {
+    // 点の位置による面積の重み付け
+    // 境界上の点は内部点の半分の面積を代表し、コーナー点は1/4の面積を代表する
+    double area_coef = 1.0;
+    
+    // 境界上の点の重み付け
+    if (i == 0 || i == ny - 1) {
+        area_coef *= 0.5;
+    }
+    if (j == 0 || j == nx - 1) {
+        area_coef *= 0.5;
+    }
+    
+    return dx * dy * area_coef;
 }
 
 double SquareThinFilmFDM::calculateTotalForce() const {
-    // 基本の面積要素
-    double area_element = dx * dy;
-    double total_force = 0.0;
-    
-    // すべての格子点での圧力と面積の積を合計
-    for (int i = 0; i < n; ++i) {
-        for (int j = 0; j < n; ++j) {
-            // 点の位置による面積の重み付け
-            // 境界上の点は内部点の半分の面積を代表し、コーナー点は1/4の面積を代表する
-            double area_coef = 1.0;
-            
-            // 境界上の点の重み付け
-            if (i == 0 || i == n - 1) {
-                area_coef *= 0.5;
-            }
-            if (j == 0 || j == n - 1) {
-                area_coef *= 0.5;
-            }
-            
-            // 修正された面積要素
-            double modified_area = area_element * area_coef;
-            
-            // 力の加算
-            total_force += P(i, j) * modified_area;
+    PD_TRACE_SCOPE("solver.integrate");
+    // 台形則の重みは方向ごとに分離できるので weight_yᵀ P weight_x
+    return weight_y.dot(P * weight_x);
+}
+
+SquareThinFilmFDM::LoadIntegrals SquareThinFilmFDM::calculateLoadIntegrals() const {
+    return integrateField(P);
+}
+
+SquareThinFilmFDM::LoadIntegrals SquareThinFilmFDM::integrateField(const Matrix& field) const {
+    PD_TRACE_SCOPE("solver.integrate");
+    if (field.rows() != ny || field.cols() != nx) {
+        std::cerr << "圧力分布の大きさ（" << field.rows() << "×" << field.cols()
+                  << "）が格子（" << ny << "×" << nx << "）と一致しません" << std::endl;
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        return makeLoadIntegrals(nan, nan, nan, nan, nan);
+    }
+    // 列（x方向の節点）ごとにy方向の重み付き和2つと最小・最大を同じループで求め、x方向に積分する
+    // 各節点の値は一度だけ読む（平均圧力は合力から求める）。4要素ずつの独立な部分和でSIMD化する
+    using Lanes = Eigen::Array4d;
+    using ConstLanes = Eigen::Map<const Lanes>;
+    const double* wy = weight_y.data();
+    const double* mwy = moment_weight_y.data();
+    const int ny_lanes = ny - ny % 4;
+    
+    double force = 0.0;
+    double moment_x = 0.0;
+    double moment_y = 0.0;
+    Lanes lanes_min = Lanes::Constant(std::numeric_limits<double>::infinity());
+    Lanes lanes_max = Lanes::Constant(-std::numeric_limits<double>::infinity());
+    double p_min = std::numeric_limits<double>::infinity();
+    double p_max = -std::numeric_limits<double>::infinity();
+    for (int j = 0; j < nx; ++j) {
+        const double* column = field.data() + static_cast<Eigen::Index>(j) * ny;
+        Lanes lanes_force = Lanes::Zero();
+        Lanes lanes_moment = Lanes::Zero();
+        for (int i = 0; i < ny_lanes; i += 4) {
+            ConstLanes p(column + i);
+            lanes_force += ConstLanes(wy + i) * p;
+            lanes_moment += ConstLanes(mwy + i) * p;
+            lanes_min = lanes_min.min(p);
+            lanes_max = lanes_max.max(p);
         }
+        double column_force = lanes_force.sum();
+        double column_moment = lanes_moment.sum();
+        for (int i = ny_lanes; i < ny; ++i) {
+            double p = column[i];
+            column_force += wy[i] * p;
+            column_moment += mwy[i] * p;
+            p_min = std::min(p_min, p);
+            p_max = std::max(p_max, p);
+        }
+        force += weight_x(j) * column_force;
+        moment_x += moment_weight_x(j) * column_force;
+        moment_y += weight_x(j) * column_moment;
     }
+    p_min = std::min(p_min, lanes_min.minCoeff());
+    p_max = std::max(p_max, lanes_max.maxCoeff());
     
-    return total_force;
+    return makeLoadIntegrals(force, moment_x, moment_y, p_min, p_max);
+}
+
+SquareThinFilmFDM::LoadIntegrals SquareThinFilmFDM::makeLoadIntegrals(double force, double moment_x,
+                                                                      double moment_y, double p_min,
+                                                                      double p_max) const {
+    LoadIntegrals load;
+    load.force = force;
+    load.moment_x = moment_x;
+    load.moment_y = moment_y;
+    load.center_x = force != 0.0 ? moment_x / force : std::numeric_limits<double>::quiet_NaN();
+    load.center_y = force != 0.0 ? moment_y / force : std::numeric_limits<double>::quiet_NaN();
+    load.mean_pressure = force / (width * height);
+    load.min_pressure = p_min;
+    load.max_pressure = p_max;
+    return load;
 }
 
 // 事前に係数行列を作成する
 void SquareThinFilmFDM::buildSystemMatrix(std::vector<Eigen::Triplet<double>>& triplets) {
-    // 係数の計算
-    Matrix h3_12mu = h.array().pow(3) / (12.0 * viscosity);
-    
+    // 係数はキャッシュ済みのh3_12muを使う
     // 内部点のみを扱う
-    int inner_n = n - 2;
+    int mx = nx - 2;
     
     // システム行列の構築
+    triplets.reserve(5 * mx * (ny - 2));
     int idx = 0;
-    for (int i = 1; i < n - 1; ++i) {
-        for (int j = 1; j < n - 1; ++j) {
+    for (int i = 1; i < ny - 1; ++i) {
+        for (int j = 1; j < nx - 1; ++j) {
             // 節点の平均膜厚係数
             double h3_e = 0.5 * (h3_12mu(i, j) + h3_12mu(i, j + 1));
             double h3_w = 0.5 * (h3_12mu(i, j) + h3_12mu(i, j - 1));
@@ -117,17 +459,17 @@ void SquareThinFilmFDM::buildSystemMatrix(std::vector<Eigen::Triplet<double>>& t
             triplets.emplace_back(idx, idx, main_coef);
             
             // 隣接点への係数
-            if (j < n - 2) {  // 東
+            if (j < nx - 2) {  // 東
                 triplets.emplace_back(idx, idx + 1, coef_e);
             }
             if (j > 1) {  // 西
                 triplets.emplace_back(idx, idx - 1, coef_w);
             }
-            if (i < n - 2) {  // 北
-                triplets.emplace_back(idx, idx + inner_n, coef_n);
+            if (i < ny - 2) {  // 北
+                triplets.emplace_back(idx, idx + mx, coef_n);
             }
             if (i > 1) {  // 南
-                triplets.emplace_back(idx, idx - inner_n, coef_s);
+                triplets.emplace_back(idx, idx - mx, coef_s);
             }
             
             idx++;
@@ -138,73 +480,569 @@ void SquareThinFilmFDM::buildSystemMatrix(std::vector<Eigen::Triplet<double>>& t
 // 事前に作成した行列のLU分解を行う(初回のみ呼び出し)
 bool SquareThinFilmFDM::buildAndFactorizeMatrix() {
     // 内部点のみを扱う
-    int inner_n = n - 2;
-    int n_unknowns = inner_n * inner_n;
+    int mx = nx - 2;
+    int my = ny - 2;
+    int n_unknowns = mx * my;
+    
+    // バックエンドの決定
+    bool uniform = hasUniformHeight();
+    active_backend = requested_backend;
+    if (active_backend == SolverBackend::Auto) {
+        active_backend = uniform ? SolverBackend::Spectral : SolverBackend::SparseLU;
+    }
+    
+    operator_built = false;
+    operator_scale = 1.0;
+    cavitation_matrix_ready = false;
+    cavitation_factorized = false;
+    
+    if (active_backend == SolverBackend::Spectral) {
+        if (!uniform) {
+            std::cerr << "Spectralバックエンドは一様膜厚でのみ使用できます" << std::endl;
+            matrix_factorized = false;
+            return false;
+        }
+        
+        // 一様係数なので行列の構築・分解は不要（固有値のみ計算）
+        PD_TRACE_SCOPE("solver.setup");
+        spectral_solver.setup(mx, my, dx, dy, h3_12mu(0, 0));
+        matrix_factorized = true;
+        return true;
+    }
+    
+    if (active_backend == SolverBackend::Multigrid) {
+        // 構造格子上で直接階層を作るので疎行列は組み立てない
+        PD_TRACE_SCOPE("solver.setup");
+        multigrid.setTolerance(iterative_tolerance);
+        multigrid.setMaxCycles(max_iterations);
+        matrix_factorized = multigrid.setup(h3_12mu, x, y);
+        return matrix_factorized;
+    }
+    
+    if (active_backend == SolverBackend::MatrixFreeCG) {
+        // 係数配列を一度だけ構築し、行列は組み立てない
+        PD_TRACE_SCOPE("solver.setup");
+        stencil.build(h3_12mu, x, y);
+        stencil_operator.attach(stencil);
+        cg_matrix_free.setTolerance(iterative_tolerance);
+        cg_matrix_free.setMaxIterations(max_iterations);
+        cg_matrix_free.compute(stencil_operator);
+        matrix_factorized = true;
+        return true;
+    }
     
     // スパース行列の構築
-    std::vector<Eigen::Triplet<double>> triplets;
-    buildSystemMatrix(triplets);
+    {
+        PD_TRACE_SCOPE("solver.assemble");
+        std::vector<Eigen::Triplet<double>> triplets;
+        buildSystemMatrix(triplets);
+        
+        A.resize(n_unknowns, n_unknowns);
+        A.setFromTriplets(triplets.begin(), triplets.end());
+    }
+    PD_TRACE_VALUE("matrix.nnz", A.nonZeros());
+    
+    PD_TRACE_SCOPE("solver.factorize");
+    if (active_backend == SolverBackend::ConjugateGradient ||
+        active_backend == SolverBackend::SimplicialLDLT) {
+        // Aは対称負定値なので符号を反転した対称正定値行列を扱う
+        A_spd = -A;
+        
+        bool success;
+        if (active_backend == SolverBackend::SimplicialLDLT) {
+            // 記号分解は一度だけ行い、膜厚更新時は数値分解のみ
+            if (!pattern_analyzed) {
+                ldlt_solver.analyzePattern(A_spd);
+                pattern_analyzed = true;
+            }
+            ldlt_solver.factorize(A_spd);
+            success = ldlt_solver.info() == Eigen::Success;
+            PD_TRACE_VALUE("factor.nnz_L", ldlt_solver.matrixL().nestedExpression().nonZeros());
+        } else if (preconditioner == Preconditioner::Jacobi) {
+            cg_jacobi.setTolerance(iterative_tolerance);
+            cg_jacobi.setMaxIterations(max_iterations);
+            cg_jacobi.compute(A_spd);
+            success = cg_jacobi.info() == Eigen::Success;
+        } else {
+            cg_ichol.setTolerance(iterative_tolerance);
+            cg_ichol.setMaxIterations(max_iterations);
+            cg_ichol.compute(A_spd);
+            success = cg_ichol.info() == Eigen::Success;
+        }
+        
+        if (!success) {
+            std::cerr << "行列の分解に失敗しました" << std::endl;
+            matrix_factorized = false;
+            return false;
+        }
+        
+        matrix_factorized = true;
+        return true;
+    }
     
-    A.resize(n_unknowns, n_unknowns);
-    A.setFromTriplets(triplets.begin(), triplets.end());
+    if (active_backend == SolverBackend::MixedPrecisionLU) {
+        // 分解は単精度で行い、倍精度の行列Aは反復改良の残差計算にのみ使う
+        Eigen::SparseMatrix<float> A_f32 = A.cast<float>();
+        if (!pattern_analyzed) {
+            solver_f32.analyzePattern(A_f32);
+            pattern_analyzed = true;
+        }
+        solver_f32.factorize(A_f32);
+        
+        if (solver_f32.info() != Eigen::Success) {
+            std::cerr << "行列の分解に失敗しました" << std::endl;
+            matrix_factorized = false;
+            return false;
+        }
+        PD_TRACE_VALUE("factor.nnz_L", solver_f32.nnzL());
+        PD_TRACE_VALUE("factor.nnz_U", solver_f32.nnzU());
+        
+        matrix_factorized = true;
+        return true;
+    }
     
-    // LU分解
-    solver.compute(A);
+    // LU分解（記号分解は一度だけ行い、膜厚更新時は数値分解のみ）
+    if (!pattern_analyzed) {
+        solver.analyzePattern(A);
+        pattern_analyzed = true;
+    }
+    solver.factorize(A);
     
     if (solver.info() != Eigen::Success) {
         std::cerr << "行列の分解に失敗しました" << std::endl;
         matrix_factorized = false;
         return false;
     }
+    PD_TRACE_VALUE("factor.nnz_L", solver.nnzL());
+    PD_TRACE_VALUE("factor.nnz_U", solver.nnzU());
     
     matrix_factorized = true;
     return true;
 }
 
-// 右辺のベクトルを構築する(毎回呼び出し)
-void SquareThinFilmFDM::buildRightHandSide(Vector& b) {
-    // 係数の計算
-    Matrix h3_12mu = h.array().pow(3) / (12.0 * viscosity);
+bool SquareThinFilmFDM::solveLinearSystem(const Vector& b, Vector& x) {
+    PD_TRACE_SCOPE("solver.solve");
+    last_solve_stats = SolveStats{0, 0.0};
     
-    // 膜厚勾配の計算（中心差分）
-    Matrix dhdx = Matrix::Zero(n, n);
+    // 現在の行列は分解した行列のoperator_scale倍（一様膜厚の変化）
+    if (operator_scale != 1.0) {
+        Vector b_scaled = b / operator_scale;
+        return solveFactorized(b_scaled, x);
+    }
+    return solveFactorized(b, x);
+}
+
+bool SquareThinFilmFDM::solveFactorized(const Vector& b, Vector& x) {
+    if (active_backend == SolverBackend::Spectral) {
+        spectral_solver.solve(b, x);
+        return true;
+    }
     
-    // 右辺ベクトルの構築
-    int idx = 0;
-    for (int i = 1; i < n - 1; ++i) {
-        for (int j = 1; j < n - 1; ++j) {
-            // 節点の平均膜厚係数
-            double h3_e = 0.5 * (h3_12mu(i, j) + h3_12mu(i, j + 1));
-            double h3_w = 0.5 * (h3_12mu(i, j) + h3_12mu(i, j - 1));
-            double h3_n = 0.5 * (h3_12mu(i, j) + h3_12mu(i + 1, j));
-            double h3_s = 0.5 * (h3_12mu(i, j) + h3_12mu(i - 1, j));
-            
-            // 中心差分の係数
-            double coef_e = h3_e / (dx * dx);
-            double coef_w = h3_w / (dx * dx);
-            double coef_n = h3_n / (dy * dy);
-            double coef_s = h3_s / (dy * dy);
-            
-            // 右辺ベクトル
-            // すべり速度による項
-            b(idx) = -6.0 * velocity * viscosity * dhdx(i, j);
-            
-            // 境界条件の寄与
-            if (j == 1) {  // 左端に隣接
-                b(idx) -= coef_w * P(i, 0);
+    if (active_backend == SolverBackend::Multigrid) {
+        bool converged = multigrid.solve(b, x);
+        last_solve_stats = SolveStats{multigrid.iterations(), multigrid.relativeResidual()};
+        if (!converged) {
+            std::cerr << "マルチグリッドが収束しませんでした（相対残差 "
+                      << multigrid.relativeResidual() << "）" << std::endl;
+        }
+        return converged;
+    }
+    
+    if (active_backend == SolverBackend::ConjugateGradient) {
+        // (-A) x = -b を解く。xのサイズが合っていれば初期値として使う
+        bool warm_start = x.size() == b.size();
+        Eigen::ComputationInfo info;
+        if (preconditioner == Preconditioner::Jacobi) {
+            x = warm_start ? Vector(cg_jacobi.solveWithGuess(-b, x)) : Vector(cg_jacobi.solve(-b));
+            last_solve_stats = SolveStats{static_cast<int>(cg_jacobi.iterations()), cg_jacobi.error()};
+            info = cg_jacobi.info();
+        } else {
+            x = warm_start ? Vector(cg_ichol.solveWithGuess(-b, x)) : Vector(cg_ichol.solve(-b));
+            last_solve_stats = SolveStats{static_cast<int>(cg_ichol.iterations()), cg_ichol.error()};
+            info = cg_ichol.info();
+        }
+        if (info != Eigen::Success) {
+            std::cerr << "共役勾配法が収束しませんでした（相対残差 "
+                      << last_solve_stats.residual << "）" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    if (active_backend == SolverBackend::MatrixFreeCG) {
+        bool warm_start = x.size() == b.size();
+        x = warm_start ? Vector(cg_matrix_free.solveWithGuess(-b, x)) : Vector(cg_matrix_free.solve(-b));
+        last_solve_stats = SolveStats{static_cast<int>(cg_matrix_free.iterations()), cg_matrix_free.error()};
+        if (cg_matrix_free.info() != Eigen::Success) {
+            std::cerr << "共役勾配法が収束しませんでした（相対残差 "
+                      << last_solve_stats.residual << "）" << std::endl;
+            return false;
+        }
+        return true;
+    }
+    
+    if (active_backend == SolverBackend::SimplicialLDLT) {
+        x = ldlt_solver.solve(-b);
+        return ldlt_solver.info() == Eigen::Success;
+    }
+    
+    if (active_backend == SolverBackend::MixedPrecisionLU) {
+        bool converged = solveMixedPrecision(b, x, last_solve_stats);
+        if (!converged) {
+            std::cerr << "反復改良が収束しませんでした（相対残差 "
+                      << last_solve_stats.residual << "）" << std::endl;
+        }
+        return converged;
+    }
+    
+    x = solver.solve(b);
+    return solver.info() == Eigen::Success;
+}
+
+bool SquareThinFilmFDM::solveMixedPrecision(const Vector& b, Vector& x, SolveStats& stats) const {
+    double b_norm = b.norm();
+    stats = SolveStats{0, 0.0};
+    if (b_norm == 0.0) {
+        x = Vector::Zero(b.size());
+        return true;
+    }
+    
+    // 単精度の範囲に収まるよう、右辺・残差は正規化してから丸める
+    Eigen::VectorXf r_f32 = (b / b_norm).cast<float>();
+    x = solver_f32.solve(r_f32).cast<double>() * b_norm;
+    if (solver_f32.info() != Eigen::Success) {
+        return false;
+    }
+    
+    Vector r = b - A * x;
+    double previous = r.norm() / b_norm;
+    stats.residual = previous;
+    while (stats.residual > iterative_tolerance && stats.iterations < max_iterations) {
+        // 補正量は単精度の分解で求め、解と残差は倍精度で更新する
+        double r_norm = r.norm();
+        r_f32 = (r / r_norm).cast<float>();
+        x += solver_f32.solve(r_f32).cast<double>() * r_norm;
+        r = b - A * x;
+        stats.iterations++;
+        stats.residual = r.norm() / b_norm;
+        
+        // 残差が減らなくなったら打ち切る（単精度の分解では条件数が大きすぎる）
+        if (stats.residual > 0.5 * previous) {
+            break;
+        }
+        previous = stats.residual;
+    }
+    
+    return stats.residual <= iterative_tolerance;
+}
+
+void SquareThinFilmFDM::prepareCavitationMatrix() {
+    // 行列を組み立てないバックエンドではここで組み立てる
+    // （係数は現在の膜厚のものなので、分解時の尺度に戻す）
+    if (active_backend == SolverBackend::Spectral || active_backend == SolverBackend::Multigrid ||
+        active_backend == SolverBackend::MatrixFreeCG) {
+        int n_unknowns = (nx - 2) * (ny - 2);
+        std::vector<Eigen::Triplet<double>> triplets;
+        buildSystemMatrix(triplets);
+        A.resize(n_unknowns, n_unknowns);
+        A.setFromTriplets(triplets.begin(), triplets.end());
+        A /= operator_scale;
+    }
+    if (active_backend != SolverBackend::ConjugateGradient &&
+        active_backend != SolverBackend::SimplicialLDLT) {
+        A_spd = -A;
+    }
+    A_spd.makeCompressed();
+    
+    // 非零パターンは -A と同じまま値だけを書き換えるので、記号分解は一度だけでよい
+    K_cav = A_spd;
+    if (!cavitation_pattern_analyzed) {
+        cavitation_solver.analyzePattern(K_cav);
+        cavitation_pattern_analyzed = true;
+    }
+    cavitation_matrix_ready = true;
+    cavitation_factorized = false;
+}
+
+bool SquareThinFilmFDM::solveCavitation(const Vector& b, Vector& x) {
+    PD_TRACE_SCOPE("solver.cavitation");
+    // 能動集合の更新回数の上限（M行列なので通常は数回で収束する）
+    constexpr int max_active_set_iterations = 100;
+    
+    if (!cavitation_matrix_ready) {
+        prepareCavitationMatrix();
+    }
+    
+    const Eigen::Index n = b.size();
+    if (static_cast<Eigen::Index>(active_set.size()) != n) {
+        active_set.assign(n, 0);
+    }
+    
+    // 分解時の尺度で扱う（現在の -A = operator_scale × A_spd）
+    // K p - f ≥ 0, p ≥ p_cav, (K p - f)·(p - p_cav) = 0 （K = A_spd, f = -b / operator_scale）
+    const Vector f = -b / operator_scale;
+    const Vector diagonal = A_spd.diagonal();
+    const int* outer = A_spd.outerIndexPtr();
+    const int* inner = A_spd.innerIndexPtr();
+    const double* values = A_spd.valuePtr();
+    double* cav_values = K_cav.valuePtr();
+    
+    CavitationStats& stats = cavitation_stats;
+    stats.iterations = 0;
+    stats.refactorizations = 0;
+    stats.reuse_iterations = 0;
+    std::vector<char> next_active(n);
+    Vector fixed(n);
+    Vector r;
+    bool converged = false;
+    while (stats.iterations < max_active_set_iterations) {
+        stats.iterations++;
+        bool any_active = std::find(active_set.begin(), active_set.end(), 1) != active_set.end();
+        
+        if (!any_active) {
+            // キャビテーション領域がなければ通常の分解で解く
+            if (!solveLinearSystem(b, x)) {
+                return false;
             }
-            if (j == n - 2) {  // 右端に隣接
-                b(idx) -= coef_e * P(i, n-1);
+        } else {
+            // 右辺: 非能動節点は f - K_{i,能動} p_cav、能動節点は K_ii p_cav
+            for (Eigen::Index i = 0; i < n; ++i) {
+                fixed(i) = active_set[i] ? cavitation_pressure : 0.0;
             }
-            if (i == 1) {  // 下端に隣接
-                b(idx) -= coef_s * P(0, j);
+            r = f - A_spd * fixed;
+            for (Eigen::Index i = 0; i < n; ++i) {
+                if (active_set[i]) {
+                    r(i) = diagonal(i) * cavitation_pressure;
+                }
             }
-            if (i == n - 2) {  // 上端に隣接
-                b(idx) -= coef_n * P(n-1, j);
+            
+            bool solved = false;
+            if (cavitation_factorized && factorized_active_set == active_set) {
+                x = cavitation_solver.solve(r);
+                solved = true;
+            } else {
+                // 能動節点の行・列は対角成分だけを残し、p = p_cav を表す
+                for (Eigen::Index col = 0; col < n; ++col) {
+                    for (int k = outer[col]; k < outer[col + 1]; ++k) {
+                        int row = inner[k];
+                        bool keep = row == col || (!active_set[row] && !active_set[col]);
+                        cav_values[k] = keep ? values[k] : 0.0;
+                    }
+                }
+                
+                if (cavitation_factorized) {
+                    // 分解済みの集合との差が k 節点なら共役勾配法は 2k+1 回程度で収束する。
+                    // その演算量が分解1回より少なく、分解後に古い分解で費やした反復と
+                    // 合わせても分解1回を超えないときだけ、分解をやり直さずに解く。
+                    // 判定は非零数と反復回数だけで行うので、同じ入力なら常に同じ経路になる
+                    Eigen::Index difference = 0;
+                    for (Eigen::Index i = 0; i < n; ++i) {
+                        difference += active_set[i] != factorized_active_set[i];
+                    }
+                    int max_cg_iterations = cavitation_reuse_budget - cavitation_reuse_spent;
+                    if (2 * difference + 1 <= max_cg_iterations) {
+                        int cg_iterations = 0;
+                        solved = solveCavitationWithStaleFactor(r, x, max_cg_iterations, cg_iterations);
+                        cavitation_reuse_spent += cg_iterations;
+                        stats.reuse_iterations += cg_iterations;
+                    }
+                }
             }
             
-            idx++;
+            if (!solved) {
+                {
+                    PD_TRACE_SCOPE("solver.cavitation_factorize");
+                    cavitation_solver.factorize(K_cav);
+                }
+                if (cavitation_solver.info() != Eigen::Success) {
+                    std::cerr << "キャビテーション領域を除いた行列の分解に失敗しました" << std::endl;
+                    cavitation_factorized = false;
+                    return false;
+                }
+                x = cavitation_solver.solve(r);
+                updateCavitationReuseBudget();
+                cavitation_reuse_spent = 0;
+                factorized_active_set = active_set;
+                cavitation_factorized = true;
+                stats.refactorizations++;
+            }
+        }
+        
+        // 乗数 λ = K p - f から次の能動集合を決める（λ_i + K_ii (p_cav - p_i) > 0）
+        Vector lambda = A_spd * x - f;
+        double tolerance = 1e-12 * std::max({1.0, std::abs(cavitation_pressure), x.cwiseAbs().maxCoeff()});
+        bool changed = false;
+        for (Eigen::Index i = 0; i < n; ++i) {
+            next_active[i] = lambda(i) / diagonal(i) + (cavitation_pressure - x(i)) > tolerance;
+            changed = changed || next_active[i] != active_set[i];
+        }
+        if (!changed) {
+            converged = true;
+            break;
+        }
+        active_set.swap(next_active);
+    }
+    
+    stats.cavitated_nodes = static_cast<int>(std::count(active_set.begin(), active_set.end(), 1));
+    stats.total_solves++;
+    stats.total_iterations += stats.iterations;
+    stats.total_refactorizations += stats.refactorizations;
+    stats.total_reuse_iterations += stats.reuse_iterations;
+    PD_TRACE_COUNT("cavitation.active_set_iterations", stats.iterations);
+    PD_TRACE_COUNT("cavitation.refactorizations", stats.refactorizations);
+    PD_TRACE_COUNT("cavitation.reuse_iterations", stats.reuse_iterations);
+    if (!converged) {
+        std::cerr << "能動集合法が収束しませんでした（" << stats.iterations << " 回）" << std::endl;
+    }
+    return converged;
+}
+
+void SquareThinFilmFDM::updateCavitationReuseBudget() {
+    // 分解の演算量は Σ_j c_j²（c_j は L の j 列の非零数）、共役勾配法1回は
+    // 前進・後退代入 4·nnz(L) と K_cav の積 2·nnz(K_cav) で見積もる
+    const SparseMatrix& L = cavitation_solver.matrixL().nestedExpression();
+    double factor_cost = 0.0;
+    double factor_nonzeros = 0.0;
+    for (Eigen::Index j = 0; j < L.outerSize(); ++j) {
+        double column = 1.0;  // 単位対角
+        for (SparseMatrix::InnerIterator it(L, j); it; ++it) {
+            column += 1.0;
+        }
+        factor_cost += column * column;
+        factor_nonzeros += column;
+    }
+    double iteration_cost = 4.0 * factor_nonzeros + 2.0 * static_cast<double>(K_cav.nonZeros());
+    cavitation_reuse_budget = static_cast<int>(std::min(factor_cost / std::max(iteration_cost, 1.0), 1e6));
+    PD_TRACE_VALUE("cavitation.reuse_budget", cavitation_reuse_budget);
+}
+
+bool SquareThinFilmFDM::solveCavitationWithStaleFactor(const Vector& r, Vector& x, int max_cg_iterations,
+                                                       int& iterations) const {
+    PD_TRACE_SCOPE("solver.cavitation_reuse");
+    constexpr double tolerance = 1e-14;
+    
+    iterations = 0;
+    const double r_norm = r.norm();
+    if (r_norm == 0.0) {
+        x.setZero(r.size());
+        return true;
+    }
+    
+    // K_cav（現在の能動集合）を、分解済みの K_cav（古い能動集合）を前処理にして解く
+    x = cavitation_solver.solve(r);
+    Vector residual = r - K_cav * x;
+    Vector z = cavitation_solver.solve(residual);
+    Vector direction = z;
+    Vector product(r.size());
+    double rz = residual.dot(z);
+    while (residual.norm() > tolerance * r_norm) {
+        if (iterations >= max_cg_iterations) {
+            return false;
+        }
+        iterations++;
+        product.noalias() = K_cav * direction;
+        double alpha = rz / direction.dot(product);
+        x += alpha * direction;
+        residual -= alpha * product;
+        z = cavitation_solver.solve(residual);
+        double rz_next = residual.dot(z);
+        direction = z + (rz_next / rz) * direction;
+        rz = rz_next;
+    }
+    return true;
+}
+
+bool SquareThinFilmFDM::solveLinearSystem(const Matrix& B, Matrix& X) {
+    PD_TRACE_SCOPE("solver.solve_multi");
+    PD_TRACE_COUNT("solver.solve_multi.columns", B.cols());
+    if (active_backend == SolverBackend::SparseLU) {
+        // キャッシュされたLU分解で全列をまとめて後退代入
+        X = solver.solve(B / operator_scale);
+        return solver.info() == Eigen::Success;
+    }
+    
+    if (active_backend == SolverBackend::SimplicialLDLT) {
+        X = ldlt_solver.solve(-B / operator_scale);
+        return ldlt_solver.info() == Eigen::Success;
+    }
+    
+    X.resize(B.rows(), B.cols());
+    Vector x;
+    for (Eigen::Index c = 0; c < B.cols(); ++c) {
+        x.resize(0);
+        if (!solveLinearSystem(Vector(B.col(c)), x)) {
+            return false;
         }
+        X.col(c) = x;
+    }
+    return true;
+}
+
+// 右辺のベクトルを構築する
+void SquareThinFilmFDM::buildRightHandSide(Vector& b, const Matrix& p_field) {
+    b = slip_rhs;
+    updateBoundaryRightHandSide(b, p_field);
+}
+
+// 右辺ベクトルのうち境界に隣接する成分のみを更新する(毎回呼び出し、O(nx + ny))
+void SquareThinFilmFDM::updateBoundaryRightHandSide(Vector& b, const Matrix& p_field) const {
+    PD_TRACE_SCOPE("solver.rhs");
+    int mx = nx - 2;
+    int my = ny - 2;
+    int last_row = (my - 1) * mx;
+    
+    // 境界に隣接する成分をすべり項に戻す
+    for (int k = 0; k < mx; ++k) {
+        b(k) = slip_rhs(k);                                    // 下端に隣接
+        b(last_row + k) = slip_rhs(last_row + k);              // 上端に隣接
+    }
+    for (int k = 0; k < my; ++k) {
+        b(k * mx) = slip_rhs(k * mx);                          // 左端に隣接
+        b(k * mx + mx - 1) = slip_rhs(k * mx + mx - 1);        // 右端に隣接
+    }
+    
+    // 境界条件の寄与
+    for (int k = 0; k < mx; ++k) {
+        b(k) -= coupling_bottom(k) * p_field(0, k + 1);
+        b(last_row + k) -= coupling_top(k) * p_field(ny-1, k + 1);
+    }
+    for (int k = 0; k < my; ++k) {
+        b(k * mx) -= coupling_left(k) * p_field(k + 1, 0);
+        b(k * mx + mx - 1) -= coupling_right(k) * p_field(k + 1, nx-1);
+    }
+}
+
+// 各辺一定の境界値に対して右辺ベクトルの境界に隣接する成分のみを更新する
+void SquareThinFilmFDM::updateBoundaryRightHandSide(Vector& b, double p_bottom, double p_right,
+                                                    double p_top, double p_left) const {
+    PD_TRACE_SCOPE("solver.rhs");
+    int mx = nx - 2;
+    int my = ny - 2;
+    int last_row = (my - 1) * mx;
+    
+    for (int k = 0; k < mx; ++k) {
+        b(k) = slip_rhs(k);
+        b(last_row + k) = slip_rhs(last_row + k);
+    }
+    for (int k = 0; k < my; ++k) {
+        b(k * mx) = slip_rhs(k * mx);
+        b(k * mx + mx - 1) = slip_rhs(k * mx + mx - 1);
+    }
+    
+    for (int k = 0; k < mx; ++k) {
+        b(k) -= coupling_bottom(k) * p_bottom;
+        b(last_row + k) -= coupling_top(k) * p_top;
+    }
+    for (int k = 0; k < my; ++k) {
+        b(k * mx) -= coupling_left(k) * p_left;
+        b(k * mx + mx - 1) -= coupling_right(k) * p_right;
+    }
+}
+
+void SquareThinFilmFDM::scatterInterior(const Vector& p_inner, Matrix& field) const {
+    int mx = nx - 2;
+    for (int i = 1; i < ny - 1; ++i) {
+        field.row(i).segment(1, mx) = p_inner.segment((i - 1) * mx, mx).transpose();
     }
 }
 
@@ -216,29 +1054,498 @@ bool SquareThinFilmFDM::solveWithCachedMatrix() {
     }
     
     // 内部点のみを扱う
-    int inner_n = n - 2;
-    int n_unknowns = inner_n * inner_n;
+    int mx = nx - 2;
     
-    // 右辺ベクトルの構築
-    Vector b = Vector::Zero(n_unknowns);
-    buildRightHandSide(b);// 境界条件を設定
+    // 右辺ベクトルの更新（境界に隣接する成分のみ）
+    updateBoundaryRightHandSide(rhs_buffer, P);
     
-    // 線形方程式を解く（キャッシュされたLU分解を使用）
-    Vector p_inner = solver.solve(b);
+    // 前ステップの内部圧力を初期値とする（反復法のウォームスタート）
+    for (int i = 1; i < ny - 1; ++i) {
+        solution_buffer.segment((i - 1) * mx, mx) = P.row(i).segment(1, mx).transpose();
+    }
     
-    if (solver.info() != Eigen::Success) {
+    // 線形方程式を解く（キャッシュされた分解を使用）
+    bool success = cavitation_enabled ? solveCavitation(rhs_buffer, solution_buffer)
+                                      : solveLinearSystem(rhs_buffer, solution_buffer);
+    solve_log.push_back(last_solve_stats);
+    if (!success) {
         std::cerr << "線形方程式の求解に失敗しました" << std::endl;
         return false;
     }
     
     // 結果を圧力場に反映
+    scatterInterior(solution_buffer, P);
+    
+    return true;
+}
+
+// 境界値→合力の線形オペレータを事前計算する(分解後に一度だけ呼び出し)
+bool SquareThinFilmFDM::buildForceOperator() {
+    PD_TRACE_SCOPE("solver.force_operator");
+    if (!matrix_factorized) {
+        std::cerr << "行列が分解されていません。先にbuildAndFactorizeMatrix()を呼び出してください。" << std::endl;
+        return false;
+    }
+    if (cavitation_enabled) {
+        std::cerr << "キャビテーションを考慮する場合は合力オペレータを使えません" << std::endl;
+        return false;
+    }
+    
+    // 内部点のみを扱う
+    int mx = nx - 2;
+    int my = ny - 2;
+    
+    // 合力と一次モーメントの内部節点の重み（w_in, w_in・x, w_in・y）
+    int n_unknowns = mx * my;
+    Matrix W(n_unknowns, kNumFunctionals);
     int idx = 0;
-    for (int i = 1; i < n - 1; ++i) {
-        for (int j = 1; j < n - 1; ++j) {
-            P(i, j) = p_inner(idx);
+    for (int i = 1; i < ny - 1; ++i) {
+        for (int j = 1; j < nx - 1; ++j) {
+            double w = interior_area_weight(idx);
+            W(idx, kForce) = w;
+            W(idx, kMomentX) = w * x(j);
+            W(idx, kMomentY) = w * y(i);
             idx++;
         }
     }
     
+    // 随伴問題 A^T Z = W を一括で解く（Aは対称なので同じ分解を使える）
+    // 汎関数 = w_bnd・p_bnd + w_in・A^{-1} b = w_bnd・p_bnd + z・b
+    Matrix Z;
+    if (!solveLinearSystem(W, Z)) {
+        std::cerr << "随伴問題の求解に失敗しました" << std::endl;
+        operator_built = false;
+        return false;
+    }
+    
+    for (int f = 0; f < kNumFunctionals; ++f) {
+        EdgeFunctional& functional = edge_functionals[f];
+        functional.adjoint = Z.col(f);
+        const Vector& z = functional.adjoint;
+        
+        // 境界節点の重み: 台形則の重み（モーメントは座標を掛ける）+ 右辺ベクトルを介した内部節点からの寄与
+        // 境界節点のみを持つ（内部の (nx-2)×(ny-2) は確保しない）
+        auto node_weight = [&](int i, int j) {
+            double w = nodeAreaWeight(i, j);
+            return f == kMomentX ? w * x(j) : (f == kMomentY ? w * y(i) : w);
+        };
+        functional.bottom.resize(nx);
+        functional.top.resize(nx);
+        functional.left.resize(ny);
+        functional.right.resize(ny);
+        for (int k = 0; k < nx; ++k) {
+            functional.bottom(k) = node_weight(0, k);
+            functional.top(k) = node_weight(ny-1, k);
+        }
+        for (int k = 0; k < ny; ++k) {
+            functional.left(k) = node_weight(k, 0);
+            functional.right(k) = node_weight(k, nx-1);
+        }
+        
+        for (int k = 1; k < ny - 1; ++k) {
+            // 左端に隣接する内部節点 (k, 1)
+            functional.left(k) -= coupling_left(k - 1) * z((k - 1) * mx);
+            // 右端に隣接する内部節点 (k, nx-2)
+            functional.right(k) -= coupling_right(k - 1) * z((k - 1) * mx + mx - 1);
+        }
+        for (int k = 1; k < nx - 1; ++k) {
+            // 下端に隣接する内部節点 (1, k)
+            functional.bottom(k) -= coupling_bottom(k - 1) * z(k - 1);
+            // 上端に隣接する内部節点 (ny-2, k)
+            functional.top(k) -= coupling_top(k - 1) * z((my - 1) * mx + k - 1);
+        }
+        
+        // 角の重みは隣接2辺に半分ずつ配分
+        functional.bottom(0) *= 0.5;
+        functional.left(0) *= 0.5;
+        functional.bottom(nx-1) *= 0.5;
+        functional.right(0) *= 0.5;
+        functional.top(0) *= 0.5;
+        functional.left(ny-1) *= 0.5;
+        functional.top(nx-1) *= 0.5;
+        functional.right(ny-1) *= 0.5;
+        functional.edge_sum << functional.bottom.sum(), functional.right.sum(),
+                               functional.top.sum(), functional.left.sum();
+    }
+    
+    // 境界値に依存しない成分（境界をゼロとしたときの右辺はすべり項のみ）
+    updateFunctionalOffsets();
+    
+    operator_built = true;
+    return true;
+}
+
+void SquareThinFilmFDM::updateFunctionalOffsets() {
+    for (auto& functional : edge_functionals) {
+        functional.offset = functional.adjoint.dot(slip_rhs);
+    }
+}
+
+double SquareThinFilmFDM::calculateForceFromEdges(double p_bottom, double p_right,
+                                                  double p_top, double p_left) const {
+    return edge_functionals[kForce].evaluate(p_bottom, p_right, p_top, p_left);
+}
+
+SquareThinFilmFDM::EdgeForceCoefficients SquareThinFilmFDM::getEdgeForceCoefficients() const {
+    EdgeForceCoefficients coefficients;
+    coefficients.weights = edge_functionals[kForce].edge_sum;
+    coefficients.offset = edge_functionals[kForce].offset;
+    return coefficients;
+}
+
+double SquareThinFilmFDM::calculateForceFromEdgeProfiles(const Vector& bottom, const Vector& right,
+                                                         const Vector& top, const Vector& left) const {
+    return edge_functionals[kForce].evaluate(bottom, right, top, left);
+}
+
+SquareThinFilmFDM::LoadIntegrals SquareThinFilmFDM::calculateLoadFromEdges(
+        double p_bottom, double p_right, double p_top, double p_left) const {
+    return makeLoadIntegrals(edge_functionals[kForce].evaluate(p_bottom, p_right, p_top, p_left),
+                             edge_functionals[kMomentX].evaluate(p_bottom, p_right, p_top, p_left),
+                             edge_functionals[kMomentY].evaluate(p_bottom, p_right, p_top, p_left),
+                             std::numeric_limits<double>::quiet_NaN(),
+                             std::numeric_limits<double>::quiet_NaN());
+}
+
+SquareThinFilmFDM::LoadIntegrals SquareThinFilmFDM::calculateLoadFromEdgeProfiles(
+        const Vector& bottom, const Vector& right, const Vector& top, const Vector& left) const {
+    return makeLoadIntegrals(edge_functionals[kForce].evaluate(bottom, right, top, left),
+                             edge_functionals[kMomentX].evaluate(bottom, right, top, left),
+                             edge_functionals[kMomentY].evaluate(bottom, right, top, left),
+                             std::numeric_limits<double>::quiet_NaN(),
+                             std::numeric_limits<double>::quiet_NaN());
+}
+
+double SquareThinFilmFDM::EdgeFunctional::evaluate(double p_bottom, double p_right,
+                                                   double p_top, double p_left) const {
+    return p_bottom * edge_sum(0) + p_right * edge_sum(1)
+         + p_top * edge_sum(2) + p_left * edge_sum(3)
+         + offset;
+}
+
+double SquareThinFilmFDM::EdgeFunctional::evaluate(const Vector& p_bottom, const Vector& p_right,
+                                                   const Vector& p_top, const Vector& p_left) const {
+    return bottom.dot(p_bottom) + right.dot(p_right)
+         + top.dot(p_top) + left.dot(p_left)
+         + offset;
+}
+
+namespace {
+
+constexpr char kOperatorMagic[8] = {'P', 'D', 'O', 'P', 'C', '0', '0', '4'};
+constexpr uint32_t kOperatorByteOrder = 0x01020304;
+
+struct OperatorCacheHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t nx;
+    uint32_t ny;
+    uint32_t backend;     // 指定されたバックエンド
+    uint64_t key;
+    double width;
+    double height;
+    double viscosity;     // 保存した随伴解の粘度
+};
+static_assert(sizeof(OperatorCacheHeader) == 56, "unexpected header layout");
+
+// FNV-1a（64ビット）
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+}
+
+std::string SquareThinFilmFDM::operatorCacheKey() const {
+    // 随伴解と境界の重みは係数 h³/12μ と格子だけで決まる。
+    // 随伴解はμに比例し境界の重みはμによらないので、μは含めず読み込み時にスケーリングする。
+    // 随伴解の精度はバックエンドによる（MixedPrecisionLUは単精度の分解）のでバックエンドを含める
+    uint32_t backend = static_cast<uint32_t>(requested_backend);
+    uint64_t hash = 14695981039346656037ULL;
+    hash = fnv1a(kOperatorMagic, sizeof(kOperatorMagic), hash);
+    hash = fnv1a(&nx, sizeof(nx), hash);
+    hash = fnv1a(&ny, sizeof(ny), hash);
+    hash = fnv1a(&backend, sizeof(backend), hash);
+    hash = fnv1a(&width, sizeof(width), hash);
+    hash = fnv1a(&height, sizeof(height), hash);
+    hash = fnv1a(h.data(), sizeof(double) * h.size(), hash);
+
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(hash));
+    return key;
+}
+
+bool SquareThinFilmFDM::saveForceOperator(const std::string& filename) const {
+    PD_TRACE_SCOPE("operator_cache.save");
+    if (!operator_built) {
+        std::cerr << "合力オペレータが構築されていません" << std::endl;
+        return false;
+    }
+    
+    OperatorCacheHeader header;
+    std::memcpy(header.magic, kOperatorMagic, sizeof(kOperatorMagic));
+    header.byte_order = kOperatorByteOrder;
+    header.nx = static_cast<uint32_t>(nx);
+    header.ny = static_cast<uint32_t>(ny);
+    header.backend = static_cast<uint32_t>(requested_backend);
+    header.key = std::stoull(operatorCacheKey(), nullptr, 16);
+    header.width = width;
+    header.height = height;
+    header.viscosity = viscosity;
+    
+    // 別のプロセスと競合しないよう一時ファイルに書いてから置き換える
+    std::string temp_file = filename + ".tmp" + std::to_string(std::random_device()());
+    {
+        std::ofstream out(temp_file, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "合力オペレータのキャッシュを作成できません: " << filename << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (const auto& functional : edge_functionals) {
+            for (const Vector* v : {&functional.bottom, &functional.right, &functional.top,
+                                    &functional.left, &functional.adjoint}) {
+                out.write(reinterpret_cast<const char*>(v->data()),
+                          static_cast<std::streamsize>(sizeof(double) * v->size()));
+            }
+        }
+        if (!out) {
+            std::cerr << "合力オペレータのキャッシュの書き込みに失敗しました: " << filename << std::endl;
+            out.close();
+            std::filesystem::remove(temp_file);
+            return false;
+        }
+    }
+    
+    std::error_code ec;
+    std::filesystem::rename(temp_file, filename, ec);
+    if (ec) {
+        std::filesystem::remove(temp_file, ec);
+        std::cerr << "合力オペレータのキャッシュを作成できません: " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SquareThinFilmFDM::loadForceOperator(const std::string& filename) {
+    PD_TRACE_SCOPE("operator_cache.load");
+    if (cavitation_enabled) {
+        std::cerr << "キャビテーションを考慮する場合は合力オペレータを使えません" << std::endl;
+        return false;
+    }
+    std::error_code ec;
+    if (!std::filesystem::exists(filename, ec)) {
+        return false;
+    }
+    
+    MappedFile file;
+    try {
+        file = MappedFile(filename);
+    } catch (const std::exception&) {
+        return false;
+    }
+    
+    size_t expected = sizeof(OperatorCacheHeader)
+                    + sizeof(double) * kNumFunctionals * (2 * nx + 2 * ny + (nx - 2) * (ny - 2));
+    if (file.size() != expected) {
+        return false;
+    }
+    
+    // 格子・バックエンドが一致することを確認（キーの衝突対策）
+    OperatorCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kOperatorMagic, sizeof(kOperatorMagic)) != 0 ||
+        header.byte_order != kOperatorByteOrder ||
+        header.nx != static_cast<uint32_t>(nx) || header.ny != static_cast<uint32_t>(ny) ||
+        header.backend != static_cast<uint32_t>(requested_backend) ||
+        header.key != std::stoull(operatorCacheKey(), nullptr, 16) ||
+        header.width != width || header.height != height ||
+        !std::isfinite(header.viscosity) || !(header.viscosity > 0.0)) {
+        return false;
+    }
+    
+    const char* data = file.data() + sizeof(header);
+    auto read = [&](Vector& v, int size) {
+        v.resize(size);
+        std::memcpy(v.data(), data, sizeof(double) * size);
+        data += sizeof(double) * size;
+    };
+    for (auto& functional : edge_functionals) {
+        read(functional.bottom, nx);
+        read(functional.right, ny);
+        read(functional.top, nx);
+        read(functional.left, ny);
+        read(functional.adjoint, (nx - 2) * (ny - 2));
+        // 随伴解は別の粘度で保存されていてもよい（setViscosity() と同じ関係）
+        if (header.viscosity != viscosity) {
+            functional.adjoint *= viscosity / header.viscosity;
+        }
+        functional.edge_sum << functional.bottom.sum(), functional.right.sum(),
+                               functional.top.sum(), functional.left.sum();
+    }
+    
+    // 速度・スクイーズ項に依存する定数項は現在の右辺から計算する
+    updateFunctionalOffsets();
+    operator_built = true;
+    return true;
+}
+
+bool SquareThinFilmFDM::buildForceOperatorCached(const std::string& cache_dir) {
+    std::filesystem::path path = std::filesystem::path(cache_dir) / (operatorCacheKey() + ".pdop");
+    if (loadForceOperator(path.string())) {
+        return true;
+    }
+    
+    if (!matrix_factorized && !buildAndFactorizeMatrix()) {
+        return false;
+    }
+    if (!buildForceOperator()) {
+        return false;
+    }
+    
+    // 保存に失敗しても計算は続けられる
+    std::error_code ec;
+    std::filesystem::create_directories(cache_dir, ec);
+    saveForceOperator(path.string());
+    return true;
+}
+
+// 複数の境界状態をまとめて解く(多右辺一括求解)
+bool SquareThinFilmFDM::solveBatch(const Matrix& edge_pressures, std::vector<double>& forces,
+                                   std::vector<Matrix>* fields, int block_size) {
+    if (!matrix_factorized) {
+        std::cerr << "行列が分解されていません。先にbuildAndFactorizeMatrix()を呼び出してください。" << std::endl;
+        return false;
+    }
+    if (cavitation_enabled) {
+        std::cerr << "キャビテーションを考慮する場合は一括求解を使えません" << std::endl;
+        return false;
+    }
+    if (edge_pressures.cols() != 4) {
+        std::cerr << "境界圧力はK×4（下・右・上・左）で指定してください" << std::endl;
+        return false;
+    }
+    
+    // 内部点のみを扱う
+    int n_unknowns = (nx - 2) * (ny - 2);
+    int num_states = static_cast<int>(edge_pressures.rows());
+    
+    // 右辺は境界値に対して線形なので、すべり項と各辺の単位圧力に対する寄与に分解する
+    const Vector& b0 = slip_rhs;
+    
+    Matrix edge_basis(n_unknowns, 4);
+    for (int e = 0; e < 4; ++e) {
+        Eigen::Vector4d unit = Eigen::Vector4d::Unit(e);
+        Matrix unit_field = Matrix::Zero(ny, nx);
+        fillEdgeBoundary(unit_field, unit(0), unit(1), unit(2), unit(3));
+        
+        Vector b_unit;
+        buildRightHandSide(b_unit, unit_field);
+        edge_basis.col(e) = b_unit - b0;
+    }
+    
+    forces.assign(num_states, 0.0);
+    if (fields) {
+        fields->assign(num_states, Matrix());
+    }
+    
+    // block_size列ずつ右辺行列を構築して一括で解く
+    for (int start = 0; start < num_states; start += block_size) {
+        int k = std::min(block_size, num_states - start);
+        auto block = edge_pressures.middleRows(start, k);
+        
+        Matrix B = edge_basis * block.transpose();
+        B.colwise() += b0;
+        
+        Matrix X;
+        if (!solveLinearSystem(B, X)) {
+            std::cerr << "線形方程式の一括求解に失敗しました" << std::endl;
+            return false;
+        }
+        
+        // 合力 = 内部節点の寄与 + 境界節点の寄与
+        Vector f = X.transpose() * interior_area_weight + block * boundary_area_sum;
+        for (int c = 0; c < k; ++c) {
+            forces[start + c] = f(c);
+        }
+        
+        if (fields) {
+            for (int c = 0; c < k; ++c) {
+                Matrix field(ny, nx);
+                fillEdgeBoundary(field, block(c, 0), block(c, 1), block(c, 2), block(c, 3));
+                scatterInterior(X.col(c), field);
+                (*fields)[start + c] = std::move(field);
+            }
+        }
+    }
+    
+    return true;
+}
+
+bool SquareThinFilmFDM::supportsConcurrentSolve() const {
+    // 直接法の後退代入は分解を読み取るだけなので複数スレッドから同時に呼べる
+    // キャビテーションを考慮する場合は前フレームの能動集合から解くので逐次のみ
+    return matrix_factorized && !cavitation_enabled &&
+           (active_backend == SolverBackend::SparseLU ||
+            active_backend == SolverBackend::MixedPrecisionLU ||
+            active_backend == SolverBackend::SimplicialLDLT ||
+            active_backend == SolverBackend::Spectral);
+}
+
+SquareThinFilmFDM::Workspace SquareThinFilmFDM::createWorkspace() const {
+    Workspace ws;
+    ws.worst_stats = SolveStats{0, 0.0};
+    ws.rhs = slip_rhs;
+    ws.solution = Vector::Zero(slip_rhs.size());
+    if (active_backend == SolverBackend::Spectral) {
+        // FFTの作業領域はスレッドごとに複製する
+        ws.spectral = spectral_solver;
+    }
+    return ws;
+}
+
+// 共有された分解を読み取るだけで各辺一定の境界状態を解く(スレッドごとの作業領域を使用)
+bool SquareThinFilmFDM::solveEdgeState(double p_bottom, double p_right, double p_top, double p_left,
+                                       Workspace& ws, double& force, Matrix* field) const {
+    if (!supportsConcurrentSolve()) {
+        std::cerr << "このバックエンドは並列求解に対応していません" << std::endl;
+        return false;
+    }
+    
+    updateBoundaryRightHandSide(ws.rhs, p_bottom, p_right, p_top, p_left);
+    
+    PD_TRACE_SCOPE("solver.solve");
+    bool success = true;
+    if (active_backend == SolverBackend::Spectral) {
+        ws.spectral.solve(ws.rhs / operator_scale, ws.solution);
+    } else if (active_backend == SolverBackend::SimplicialLDLT) {
+        ws.solution = ldlt_solver.solve(-ws.rhs / operator_scale);
+        success = ldlt_solver.info() == Eigen::Success;
+    } else if (active_backend == SolverBackend::MixedPrecisionLU) {
+        SolveStats stats;
+        success = solveMixedPrecision(ws.rhs / operator_scale, ws.solution, stats);
+        ws.worst_stats.iterations = std::max(ws.worst_stats.iterations, stats.iterations);
+        ws.worst_stats.residual = std::max(ws.worst_stats.residual, stats.residual);
+    } else {
+        ws.solution = solver.solve(ws.rhs / operator_scale);
+        success = solver.info() == Eigen::Success;
+    }
+    if (!success) {
+        return false;
+    }
+    
+    force = interior_area_weight.dot(ws.solution)
+          + boundary_area_sum.dot(Eigen::Vector4d(p_bottom, p_right, p_top, p_left));
+    
+    if (field) {
+        field->resize(ny, nx);
+        fillEdgeBoundary(*field, p_bottom, p_right, p_top, p_left);
+        scatterInterior(ws.solution, *field);
+    }
+    
     return true;
 }
\ No newline at end of file
@@ -1,6 +1,14 @@
+#pragma once
+
 #include <Eigen/Sparse>
+#include <Eigen/IterativeLinearSolvers>
+#include <array>
 #include <vector>
 #include <functional>
+#include <string>
+#include "spectral_poisson_solver.hpp"
+#include "multigrid.hpp"
+#include "reynolds_operator.hpp"
 
 class SquareThinFilmFDM {
 public:
@@ -8,28 +16,202 @@ public:
     using SparseMatrix = Eigen::SparseMatrix<double>;
     using Vector = Eigen::VectorXd;
     using HeightFunction = std::function<double(double, double)>;
+    
+    /**
+     * 線形ソルバーのバックエンド
+     */
+    enum class SolverBackend {
+        Auto,       // 膜厚が一様ならSpectral、そうでなければSparseLU
+        SparseLU,   // 疎行列LU分解（一般の膜厚分布）
+        Spectral,   // 離散サイン変換による直接法（一様膜厚のみ）
+        Multigrid,  // 幾何マルチグリッド法（大規模な不均一膜厚向け）
+        ConjugateGradient, // 前処理付き共役勾配法（-Aは対称正定値）
+        SimplicialLDLT,    // 疎行列Cholesky(LDLT)分解（LUの約半分のメモリ・時間）
+        MatrixFreeCG,      // 行列を組み立てないステンシル演算子による対角前処理付きCG
+        MixedPrecisionLU   // 単精度のLU分解＋倍精度の残差による反復改良（分解のメモリが半分）
+    };
+    
+    /**
+     * 共役勾配法の前処理
+     */
+    enum class Preconditioner {
+        Jacobi,             // 対角スケーリング
+        IncompleteCholesky  // 不完全Cholesky分解
+    };
+    
+    /**
+     * 膜厚勾配 ∂h/∂x の差分スキーム
+     */
+    enum class GradientScheme {
+        Central,    // 中心差分
+        Upwind      // すべり速度の向きに応じた風上差分
+    };
+    
+    /**
+     * 圧力分布の荷重積分
+     *
+     * 点 (x0, y0) まわりのモーメントは moment_x - x0·force（y軸まわり、ピッチ）、
+     * moment_y - y0·force（x軸まわり、ロール）で求まる。
+     */
+    struct LoadIntegrals {
+        double force;          // 合力 ∫p dA [N]
+        double moment_x;       // x方向の一次モーメント ∫p·x dA [N・m]
+        double moment_y;       // y方向の一次モーメント ∫p·y dA [N・m]
+        double center_x;       // 圧力中心のx座標 moment_x / force [m]（合力が0なら非数）
+        double center_y;       // 圧力中心のy座標 moment_y / force [m]（合力が0なら非数）
+        double mean_pressure;  // 面積平均圧力 force / (幅×高さ) [Pa]
+        double min_pressure;   // 最小圧力 [Pa]（オペレータモードでは非数）
+        double max_pressure;   // 最大圧力 [Pa]（オペレータモードでは非数）
+    };
+    
+    /**
+     * 各辺一定の境界圧力に対する合力オペレータの係数（getEdgeForceCoefficients()）
+     *
+     * 合力 = 下辺×weights(0) + 右辺×weights(1) + 上辺×weights(2) + 左辺×weights(3) + offset。
+     * 取り出した時点の粘度・速度のもので、ソルバーを参照しないので別スレッドで評価できる。
+     */
+    struct EdgeForceCoefficients {
+        Eigen::Vector4d weights = Eigen::Vector4d::Zero();
+        double offset = 0.0;
+        
+        /**
+         * 合力を計算する（calculateForceFromEdges と同じ演算順序なので結果も一致する）
+         */
+        double evaluate(double p_bottom, double p_right, double p_top, double p_left) const {
+            return p_bottom * weights(0) + p_right * weights(1)
+                 + p_top * weights(2) + p_left * weights(3)
+                 + offset;
+        }
+    };
+    
+    /**
+     * 反復法の収束情報
+     */
+    struct SolveStats {
+        int iterations;      // 反復回数（直接法では0、MixedPrecisionLUでは反復改良の回数）
+        double residual;     // 相対残差 ||b - A x|| / ||b||
+    };
+    
+    /**
+     * キャビテーションを考慮した求解（能動集合法）の統計
+     */
+    struct CavitationStats {
+        int iterations = 0;             // 直前の求解での能動集合の更新回数（前フレームの集合が正しければ1）
+        int refactorizations = 0;       // 直前の求解で数値分解をやり直した回数
+        int reuse_iterations = 0;       // 直前の求解で古い分解を前処理にした共役勾配法の反復回数
+        int cavitated_nodes = 0;        // キャビテーション領域（p = p_cav に固定した）の内部節点数
+        long long total_solves = 0;     // 累計の求解回数
+        long long total_iterations = 0; // 累計の能動集合の更新回数
+        long long total_refactorizations = 0; // 累計の数値分解の回数
+        long long total_reuse_iterations = 0; // 累計の共役勾配法の反復回数
+    };
+    
+    /**
+     * 並列求解用のスレッドごとの作業領域
+     */
+    struct Workspace {
+        Vector rhs;                      // 右辺ベクトル
+        Vector solution;                 // 内部点の解
+        SpectralPoissonSolver spectral;  // DSTソルバーの複製（Spectralバックエンド用）
+        SolveStats worst_stats;          // この作業領域での最大の反復回数・相対残差
+    };
 
 private:
-    int n;                    // 格子点数
+    int nx;                   // x方向の格子点数
+    int ny;                   // y方向の格子点数
     double width;            // 長方形の幅[m]
     double height;           // 長方形の高さ[m]
     double viscosity;        // 粘度 [Pa・s]
     double velocity;         // すべり速度 [m/s]
+    GradientScheme gradient_scheme; // 膜厚勾配の差分スキーム
     
     double dx;               // x方向格子間隔
     double dy;               // y方向格子間隔
     
     Vector x;                // x座標
     Vector y;                // y座標
-    Matrix X;                // x座標メッシュ
-    Matrix Y;                // y座標メッシュ
-    Matrix P;                // 圧力場
+    Matrix P;                // 圧力場（ny×nx、行がy方向）
     Matrix h;                // 膜厚
+    Matrix dhdt;             // 膜厚の時間変化率 ∂h/∂t（スクイーズ項）
+    
+    // 係数のキャッシュ（h, viscosity, velocityが変わったときのみ再計算）
+    Matrix h3_12mu;          // 節点の係数 h³/12μ
+    Vector coupling_bottom;  // 下端に隣接する内部節点と境界節点の結合係数
+    Vector coupling_right;   // 右端に隣接する内部節点と境界節点の結合係数
+    Vector coupling_top;     // 上端に隣接する内部節点と境界節点の結合係数
+    Vector coupling_left;    // 左端に隣接する内部節点と境界節点の結合係数
+    Vector slip_rhs;         // すべり・スクイーズによる右辺の項 (U/2)∂h/∂x + ∂h/∂t
+    Vector rhs_buffer;       // 毎ステップの右辺ベクトル（事前確保）
+    Vector solution_buffer;  // 毎ステップの解ベクトル（事前確保）
+    Vector interior_area_weight;     // 内部節点の台形則の面積重み
+    Vector weight_x;                 // x方向の台形則の重み（節点の面積重みは weight_y(i)·weight_x(j)）
+    Vector weight_y;                 // y方向の台形則の重み
+    Vector moment_weight_x;          // weight_x・x（一次モーメント用）
+    Vector moment_weight_y;          // weight_y・y（一次モーメント用）
+    Eigen::Vector4d boundary_area_sum; // 各辺の単位圧力に対する境界節点の面積重みの和（下・右・上・左）
     
     // 最適化のためのキャッシュ
     SparseMatrix A;          // システム行列のキャッシュ
+    SparseMatrix A_spd;      // -A（対称正定値、CG・LDLT用）
     Eigen::SparseLU<SparseMatrix> solver; // ソルバーのキャッシュ
+    Eigen::SimplicialLDLT<SparseMatrix> ldlt_solver; // 対称正定値用の直接法
+    Eigen::SparseLU<Eigen::SparseMatrix<float>> solver_f32; // 単精度のLU分解（MixedPrecisionLU用）
+    Eigen::ConjugateGradient<SparseMatrix, Eigen::Lower | Eigen::Upper,
+                             Eigen::DiagonalPreconditioner<double>> cg_jacobi;
+    Eigen::ConjugateGradient<SparseMatrix, Eigen::Lower | Eigen::Upper,
+                             Eigen::IncompleteCholesky<double>> cg_ichol;
+    SpectralPoissonSolver spectral_solver; // 一様膜厚用のDSTソルバー
     bool matrix_factorized;  // 行列が分解済みかのフラグ
+    bool pattern_analyzed;   // 非零パターンの記号分解が済んでいるかのフラグ
+    double operator_scale;   // 現在の行列 = operator_scale × 分解済みの行列（一様膜厚の変化）
+    SolverBackend requested_backend; // 指定されたバックエンド
+    SolverBackend active_backend;    // 実際に使用しているバックエンド
+    GeometricMultigrid multigrid;    // 大規模格子用のマルチグリッドソルバー
+    ReynoldsStencil stencil;         // 係数配列（行列を組み立てない演算子用）
+    ReynoldsOperator stencil_operator; // stencilを参照する-Aの演算子
+    Eigen::ConjugateGradient<ReynoldsOperator, Eigen::Lower | Eigen::Upper,
+                             StencilJacobiPreconditioner> cg_matrix_free;
+    double iterative_tolerance;  // 反復法の相対残差の収束判定値
+    int max_iterations;          // 反復法の最大反復回数
+    Preconditioner preconditioner;   // 共役勾配法の前処理
+    SolveStats last_solve_stats; // 直前の求解の収束情報
+    std::vector<SolveStats> solve_log; // ステップごとの収束履歴
+    
+    // キャビテーション（Reynolds境界条件 p ≥ p_cav）
+    bool cavitation_enabled;         // 圧力の下限を課すかどうか
+    double cavitation_pressure;      // キャビテーション圧力 p_cav [Pa]
+    bool cavitation_matrix_ready;    // A_spd・K_cav が現在の膜厚のものかどうか
+    bool cavitation_pattern_analyzed; // K_cav の記号分解が済んでいるか（非零パターンは膜厚によらない）
+    bool cavitation_factorized;      // cavitation_solver が factorized_active_set で分解済みか
+    SparseMatrix K_cav;              // 能動節点の非対角成分を0にした -A（非零パターンは -A と同じ）
+    Eigen::SimplicialLDLT<SparseMatrix> cavitation_solver; // K_cav の分解
+    std::vector<char> active_set;    // 能動集合（p = p_cav に固定する内部節点、次のフレームの初期値）
+    std::vector<char> factorized_active_set; // cavitation_solver が分解している能動集合
+    int cavitation_reuse_budget;      // 分解1回と同じ演算量になる共役勾配法の反復回数（L の非零数から求める）
+    int cavitation_reuse_spent;       // 直前の分解の後、古い分解での共役勾配法に費やした反復回数
+    CavitationStats cavitation_stats;
+    
+    /**
+     * 境界値に対する線形汎関数（合力・一次モーメント）のオペレータ
+     */
+    struct EdgeFunctional {
+        Vector adjoint;          // 随伴解 z（A z = w_in の解、w_in は汎関数の内部節点の重み）
+        Vector bottom;           // 下辺の各節点に対する重み
+        Vector right;            // 右辺の各節点に対する重み
+        Vector top;              // 上辺の各節点に対する重み
+        Vector left;             // 左辺の各節点に対する重み
+        Eigen::Vector4d edge_sum = Eigen::Vector4d::Zero(); // 各辺の重みの総和（下・右・上・左）
+        double offset = 0.0;     // 境界値に依存しない成分（すべり項の寄与）
+        
+        double evaluate(double p_bottom, double p_right, double p_top, double p_left) const;
+        double evaluate(const Vector& p_bottom, const Vector& p_right,
+                        const Vector& p_top, const Vector& p_left) const;
+    };
+    
+    // 境界値→合力・モーメントオペレータ（オペレータモード）のキャッシュ
+    enum { kForce = 0, kMomentX = 1, kMomentY = 2, kNumFunctionals = 3 };
+    std::array<EdgeFunctional, kNumFunctionals> edge_functionals;
+    bool operator_built;         // オペレータが構築済みかのフラグ
 
 public:
     /**
@@ -44,6 +226,21 @@ public:
     SquareThinFilmFDM(int n, double side_width, double side_height, 
                      HeightFunction h_func = nullptr, 
                      double viscosity = 0.01, double velocity = 1.0);
+    
+    /**
+     * コンストラクタ（方向ごとに格子点数を指定）
+     * 細長い領域では格子間隔がそろうように nx : ny を幅と高さの比に近づけるとよい。
+     * @param nx x方向の格子点数
+     * @param ny y方向の格子点数
+     * @param side_width 長方形の幅[m]
+     * @param side_height 長方形の高さ[m]
+     * @param h_func 膜厚を計算する関数 h(x, y)、nullptrの場合は一定膜厚
+     * @param viscosity 粘度 [Pa・s]
+     * @param velocity すべり速度 [m/s]（x方向正）
+     */
+    SquareThinFilmFDM(int nx, int ny, double side_width, double side_height,
+                     HeightFunction h_func = nullptr,
+                     double viscosity = 0.01, double velocity = 1.0);
 
     /**
      * 各辺に異なる一定圧力を設定
@@ -54,6 +251,127 @@ public:
      */
     void setEdgeBoundary(double p_bottom, double p_right, double p_top, double p_left);
     
+    /**
+     * 粘度を変更する
+     *
+     * 係数は全節点で 1/μ 倍になるだけなので、分解済みなら再分解せずに
+     * 解をスケーリングする（合力オペレータも境界の重みは不変で定数項のみ更新）。
+     * @param mu 粘度 [Pa・s]
+     */
+    void setViscosity(double mu);
+    
+    /**
+     * すべり速度を変更する（右辺のキャッシュのみ更新し、再分解は不要）
+     * @param u すべり速度 [m/s]
+     */
+    void setVelocity(double u);
+    
+    /**
+     * 膜厚勾配の差分スキームを変更する（右辺のキャッシュのみ更新）
+     * @param scheme 差分スキーム（既定はCentral）
+     */
+    void setGradientScheme(GradientScheme scheme);
+    
+    /**
+     * 一様な膜厚（すき間）を変更する
+     * 現在の膜厚も一様で分解済みなら、係数が (gap/h)³ 倍になるだけなので
+     * 再分解せずに解をスケーリングする。そうでなければsetFilmThickness()と同じ。
+     * @param gap 新しい膜厚 [m]
+     * @param dt 前回からの時間刻み [s]（正ならスクイーズ項 ∂h/∂t を含める）
+     * @return 更新が成功したかどうか
+     */
+    bool setUniformGap(double gap, double dt = 0.0);
+    
+    /**
+     * 膜厚分布を変更する
+     * 分解済みなら非零パターンの記号分解を再利用して数値分解のみやり直す。
+     * 合力オペレータが構築済みなら再構築する。
+     * @param h_new 新しい膜厚分布（ny×nx）[m]
+     * @param dt 前回からの時間刻み [s]（正ならスクイーズ項 ∂h/∂t を含める）
+     * @return 更新が成功したかどうか
+     */
+    bool setFilmThickness(const Matrix& h_new, double dt = 0.0);
+    
+    /**
+     * 線形ソルバーのバックエンドを指定する（buildAndFactorizeMatrix()の前に呼び出す）
+     * @param backend バックエンド（既定はAuto）
+     */
+    void setSolverBackend(SolverBackend backend);
+    
+    /**
+     * 実際に使用しているバックエンドを取得（Autoは分解時に解決される）
+     */
+    SolverBackend getActiveBackend() const { return active_backend; }
+    
+    /**
+     * 共役勾配法の前処理を設定する（buildAndFactorizeMatrix()の前に呼び出す）
+     */
+    void setPreconditioner(Preconditioner pc);
+    
+    /**
+     * 反復法（Multigrid/ConjugateGradient/MixedPrecisionLUの反復改良）の収束判定値を設定する
+     * @param tolerance 相対残差の収束判定値
+     * @param max_iter 最大反復回数
+     */
+    void setIterativeTolerance(double tolerance, int max_iter = 100);
+    
+    /**
+     * マルチグリッドのサイクル（V/W）を設定する
+     */
+    void setMultigridCycle(GeometricMultigrid::Cycle cycle) { multigrid.setCycle(cycle); }
+    
+    /**
+     * 直前の求解の収束情報を取得
+     */
+    const SolveStats& getLastSolveStats() const { return last_solve_stats; }
+    
+    /**
+     * solveWithCachedMatrix()ごとの収束履歴を取得
+     */
+    const std::vector<SolveStats>& getSolveLog() const { return solve_log; }
+    
+    /**
+     * 収束履歴を消去
+     */
+    void clearSolveLog() { solve_log.clear(); }
+    
+    /**
+     * キャビテーション（Reynolds境界条件）を設定する
+     *
+     * 有効にすると内部の圧力に下限 p ≥ p_cav を課し、相補性問題
+     *   -A p + b ≥ 0,  p - p_cav ≥ 0,  (-A p + b)·(p - p_cav) = 0
+     * を主双対能動集合法（半平滑Newton法）で解く。能動集合は前フレームの
+     * キャビテーション領域から始めるので、領域が変わらなければ1回の後退代入で済む。
+     * 領域の変化が小さいときは分解済みの行列を前処理にした共役勾配法で解き、
+     * 収束しないときだけ、記号分解を再利用して数値分解をやり直す。
+     * 非線形になるので合力オペレータ・一括求解・並列求解は使えない。
+     * @param enabled 有効にするかどうか
+     * @param pressure キャビテーション圧力 p_cav [Pa]（境界圧力と同じ基準）
+     */
+    void setCavitation(bool enabled, double pressure = 0.0);
+    
+    bool isCavitationEnabled() const { return cavitation_enabled; }
+    
+    /**
+     * キャビテーションを考慮した求解の統計を取得
+     */
+    const CavitationStats& getCavitationStats() const { return cavitation_stats; }
+    
+    /**
+     * 膜厚が一様かどうか（一様なら係数一定のラプラシアンになる）
+     */
+    bool hasUniformHeight() const;
+    
+    /**
+     * 各辺に節点ごとの圧力分布を設定（角は隣接2辺の平均）
+     * @param bottom 下辺の圧力 [Pa]（x方向にnx点）
+     * @param right 右辺の圧力 [Pa]（y方向にny点）
+     * @param top 上辺の圧力 [Pa]（x方向にnx点）
+     * @param left 左辺の圧力 [Pa]（y方向にny点）
+     */
+    void setEdgeProfiles(const Vector& bottom, const Vector& right,
+                         const Vector& top, const Vector& left);
+    
     /**
      * システム行列を一度だけ構築・分解する（最適化用）
      * @return 構築・分解が成功したかどうか
@@ -65,12 +383,168 @@ public:
      * @return 解が成功したかどうか
      */
     bool solveWithCachedMatrix();
+    
+    /**
+     * 境界値から合力・一次モーメントへの線形オペレータを事前計算する（オペレータモード）
+     * 随伴問題を一度だけ（3つの右辺をまとめて）解き、合力とモーメントを境界節点上の内積として表す。
+     * buildAndFactorizeMatrix()の後に呼び出すこと。
+     * @return 構築が成功したかどうか
+     */
+    bool buildForceOperator();
+    
+    /**
+     * オペレータモードで各辺一定圧力に対する合力を計算する（O(1)）
+     * setEdgeBoundary() + solveWithCachedMatrix() + calculateTotalForce() と等価
+     * @param p_bottom 下辺の圧力 [Pa]
+     * @param p_right 右辺の圧力 [Pa]
+     * @param p_top 上辺の圧力 [Pa]
+     * @param p_left 左辺の圧力 [Pa]
+     * @return 合力 [N]
+     */
+    double calculateForceFromEdges(double p_bottom, double p_right,
+                                   double p_top, double p_left) const;
+    
+    /**
+     * 現在の粘度・速度での合力オペレータの係数を取り出す（buildForceOperator() の後に呼び出すこと）
+     * @return 係数（evaluate() は calculateForceFromEdges() と同じ値を返す）
+     */
+    EdgeForceCoefficients getEdgeForceCoefficients() const;
+    
+    /**
+     * オペレータモードで節点ごとの境界分布に対する合力を計算する（O(nx + ny)）
+     * setEdgeProfiles() + solveWithCachedMatrix() + calculateTotalForce() と等価
+     * @param bottom 下辺の圧力 [Pa]（nx点）
+     * @param right 右辺の圧力 [Pa]（ny点）
+     * @param top 上辺の圧力 [Pa]（nx点）
+     * @param left 左辺の圧力 [Pa]（ny点）
+     * @return 合力 [N]
+     */
+    double calculateForceFromEdgeProfiles(const Vector& bottom, const Vector& right,
+                                          const Vector& top, const Vector& left) const;
+    
+    /**
+     * オペレータモードで各辺一定圧力に対する合力・モーメント・圧力中心を計算する（O(1)）
+     * 圧力分布を解かないので最小・最大圧力は非数になる。
+     * @param p_bottom 下辺の圧力 [Pa]
+     * @param p_right 右辺の圧力 [Pa]
+     * @param p_top 上辺の圧力 [Pa]
+     * @param p_left 左辺の圧力 [Pa]
+     * @return 荷重積分
+     */
+    LoadIntegrals calculateLoadFromEdges(double p_bottom, double p_right,
+                                         double p_top, double p_left) const;
+    
+    /**
+     * オペレータモードで節点ごとの境界分布に対する合力・モーメント・圧力中心を計算する（O(nx + ny)）
+     * @param bottom 下辺の圧力 [Pa]（nx点）
+     * @param right 右辺の圧力 [Pa]（ny点）
+     * @param top 上辺の圧力 [Pa]（nx点）
+     * @param left 左辺の圧力 [Pa]（ny点）
+     * @return 荷重積分（最小・最大圧力は非数）
+     */
+    LoadIntegrals calculateLoadFromEdgeProfiles(const Vector& bottom, const Vector& right,
+                                                const Vector& top, const Vector& left) const;
+    
+    /**
+     * 複数の境界状態をまとめて解く（多右辺一括求解）
+     * K個の右辺を(nx-2)(ny-2)×Kの行列にまとめ、SparseLUバックエンドではキャッシュされた
+     * LU分解で一括して後退代入する。
+     * buildAndFactorizeMatrix()の後に呼び出すこと。Pは変更しない。
+     * @param edge_pressures K×4の境界圧力 [Pa]（各行が 下・右・上・左）
+     * @param forces 各境界状態の合力 [N]（K個）
+     * @param fields nullptrでなければ各境界状態の圧力分布（K個）を格納する
+     * @param block_size 一度に解く右辺の最大列数（メモリ使用量の上限）
+     * @return 解が成功したかどうか
+     */
+    bool solveBatch(const Matrix& edge_pressures, std::vector<double>& forces,
+                    std::vector<Matrix>* fields = nullptr, int block_size = 32);
+    
+    /**
+     * 分解を共有したまま複数スレッドから solveEdgeState() を呼べるか
+     * （SparseLU・SimplicialLDLT・Spectralの直接法のみ）
+     */
+    bool supportsConcurrentSolve() const;
+    
+    /**
+     * スレッドごとの作業領域を作成する（分解後に呼び出す）
+     */
+    Workspace createWorkspace() const;
+    
+    /**
+     * 共有された分解を読み取るだけで各辺一定の境界状態を解く（スレッドセーフ）
+     * Pは変更せず、作業領域wsのみを使う。
+     * @param p_bottom 下辺の圧力 [Pa]
+     * @param p_right 右辺の圧力 [Pa]
+     * @param p_top 上辺の圧力 [Pa]
+     * @param p_left 左辺の圧力 [Pa]
+     * @param ws このスレッド専用の作業領域
+     * @param force 合力 [N]
+     * @param field nullptrでなければ圧力分布を格納する
+     * @return 解が成功したかどうか
+     */
+    bool solveEdgeState(double p_bottom, double p_right, double p_top, double p_left,
+                        Workspace& ws, double& force, Matrix* field = nullptr) const;
+    
+    /**
+     * オペレータが構築済みかどうか
+     */
+    bool hasForceOperator() const { return operator_built; }
+    
+    /**
+     * 行列が分解済みかどうか（キャッシュからオペレータを読み込んだだけならfalse）
+     */
+    bool isMatrixFactorized() const { return matrix_factorized; }
+    
+    /**
+     * 合力オペレータをディスクキャッシュから読み込み、なければ構築して保存する
+     *
+     * キャッシュのファイル名は operatorCacheKey() で、格子・膜厚分布・バックエンドが同じなら
+     * 境界条件・速度・粘度が違っても再利用できる（速度・スクイーズ項は定数項として再計算し、
+     * 随伴解は保存時の粘度との比でスケーリングする）。
+     * 読み込めた場合は行列の分解を行わないので、使えるのはcalculateForceFromEdges系のみ
+     * （圧力分布を解くにはbuildAndFactorizeMatrix()が必要）。
+     * @param cache_dir キャッシュディレクトリ（なければ作成する）
+     * @return オペレータが使える状態になったかどうか
+     */
+    bool buildForceOperatorCached(const std::string& cache_dir);
+    
+    /**
+     * 合力オペレータをファイルに保存する
+     * @param filename ファイル名
+     * @return 成功したかどうか
+     */
+    bool saveForceOperator(const std::string& filename) const;
+    
+    /**
+     * 保存した合力オペレータをメモリマップで読み込む
+     * @param filename ファイル名
+     * @return 読み込めたかどうか（ファイルがない・形式や格子が一致しない場合はfalse）
+     */
+    bool loadForceOperator(const std::string& filename);
+    
+    /**
+     * 合力オペレータのキャッシュキー（格子・膜厚分布・バックエンドのFNV-1aハッシュ、16進16桁）
+     */
+    std::string operatorCacheKey() const;
 
     /**
      * 領域全体にわたる合力を計算する
      * @return 合力 [N]
      */
     double calculateTotalForce() const;
+    
+    /**
+     * 現在の圧力分布の合力・モーメント・圧力中心・最小/最大/平均圧力を1回の走査で計算する
+     * @return 荷重積分
+     */
+    LoadIntegrals calculateLoadIntegrals() const;
+    
+    /**
+     * 任意の圧力分布（solveBatch()・solveEdgeState()の出力など）の荷重積分を計算する
+     * @param field 圧力分布（ny×nx）
+     * @return 荷重積分（圧力分布の大きさが格子と一致しなければすべて非数）
+     */
+    LoadIntegrals integrateField(const Matrix& field) const;
 
     /**
      * 圧力分布を取得
@@ -84,9 +558,32 @@ public:
      */
     const Matrix& getHeightField() const { return h; }
 
+    /**
+     * x方向の節点座標（圧力分布の列に対応）
+     */
+    const Vector& getXCoordinates() const { return x; }
+
+    /**
+     * y方向の節点座標（圧力分布の行に対応）
+     */
+    const Vector& getYCoordinates() const { return y; }
+
+    int getNx() const { return nx; }
+    int getNy() const { return ny; }
+
 private:
     void initializeHeight(HeightFunction h_func);
     
+    /**
+     * 台形則の面積重みを事前計算する（内部関数）
+     */
+    void initializeAreaWeights();
+    
+    /**
+     * 係数キャッシュ（h³/12μ、境界結合係数、すべり項）を構築する（内部関数）
+     */
+    void updateCoefficientCache();
+    
     /**
      * システム行列のみを構築する（内部関数）
      * @param triplets 行列の非零要素を格納するtripletのリスト
@@ -96,6 +593,106 @@ private:
     /**
      * 右辺ベクトルを構築する（内部関数）
      * @param b 右辺ベクトル
+     * @param p_field 境界値を参照する圧力場
+     */
+    void buildRightHandSide(Vector& b, const Matrix& p_field);
+    
+    /**
+     * 右辺ベクトルの境界に隣接する成分のみを更新する（内部関数、O(nx + ny)）
+     * それ以外の成分はすべり項のまま保たれている前提
+     * @param b 右辺ベクトル
+     * @param p_field 境界値を参照する圧力場
+     */
+    void updateBoundaryRightHandSide(Vector& b, const Matrix& p_field) const;
+    
+    /**
+     * 各辺一定の境界値に対して右辺ベクトルの境界に隣接する成分のみを更新する（内部関数）
+     */
+    void updateBoundaryRightHandSide(Vector& b, double p_bottom, double p_right,
+                                     double p_top, double p_left) const;
+    
+    /**
+     * 内部点の解ベクトルを圧力場の内部に書き込む（内部関数）
+     */
+    void scatterInterior(const Vector& p_inner, Matrix& field) const;
+    
+    /**
+     * 分解済みのバックエンドで A x = b を解く（内部関数）
+     * 反復法ではxのサイズが合っていれば初期値として使う
+     */
+    bool solveLinearSystem(const Vector& b, Vector& x);
+    
+    /**
+     * 分解済みの行列（スケーリング前）で A x = b を解く（内部関数）
+     */
+    bool solveFactorized(const Vector& b, Vector& x);
+    
+    /**
+     * 単精度のLU分解で解き、倍精度の残差 b - A x で反復改良する（内部関数）
+     * 分解と行列を読み取るだけなので複数スレッドから同時に呼べる
+     * @param b 右辺ベクトル
+     * @param x 解
+     * @param stats 反復改良の回数と最終的な相対残差
+     * @return 収束判定値まで残差が下がったかどうか
+     */
+    bool solveMixedPrecision(const Vector& b, Vector& x, SolveStats& stats) const;
+    
+    /**
+     * キャビテーションを考慮して解く（主双対能動集合法、active_setから開始）
+     * @param b 右辺ベクトル（A p = b）
+     * @param x 内部点の解
+     * @return 能動集合が収束したかどうか
+     */
+    bool solveCavitation(const Vector& b, Vector& x);
+    
+    /**
+     * 能動集合法で使う -A と K_cav の非零パターンを準備する
+     */
+    void prepareCavitationMatrix();
+    
+    /**
+     * 分解1回の演算量を共役勾配法1回の演算量で割った値（cavitation_reuse_budget）を求める
+     */
+    void updateCavitationReuseBudget();
+    
+    /**
+     * 現在の能動集合の K_cav を、古い能動集合で分解した K_cav を前処理にした共役勾配法で解く
+     *
+     * 分解した能動集合との差が k 節点なら前処理後の行列は単位行列の低ランク修正なので、
+     * 2k+1 回程度で収束する。
+     * @param r 右辺ベクトル
+     * @param x 解（収束しなかったときは不定）
+     * @param max_cg_iterations 反復回数の上限
+     * @param iterations 反復回数
+     * @return 上限の反復回数以内に収束したかどうか
+     */
+    bool solveCavitationWithStaleFactor(const Vector& r, Vector& x, int max_cg_iterations,
+                                        int& iterations) const;
+    
+    /**
+     * 分解済みのバックエンドで複数の右辺 A X = B を解く（内部関数）
+     */
+    bool solveLinearSystem(const Matrix& B, Matrix& X);
+    
+    /**
+     * 圧力場の境界に各辺一定の圧力を書き込む（角は平均値）
+     */
+    void fillEdgeBoundary(Matrix& field, double p_bottom, double p_right,
+                          double p_top, double p_left) const;
+    
+    /**
+     * 台形則による節点(i, j)の面積重み
+     */
+    double nodeAreaWeight(int i, int j) const;
+    
+    /**
+     * 各汎関数の定数項（すべり項の寄与）を現在の右辺から更新する（内部関数）
+     */
+    void updateFunctionalOffsets();
+    
+    /**
+     * 合力・一次モーメント・最小/最大圧力から荷重積分をまとめる（内部関数）
      */
-    void buildRightHandSide(Vector& b);
+    LoadIntegrals makeLoadIntegrals(double force, double moment_x, double moment_y,
+                                    double p_min, double p_max) const;
 };
\ No newline at end of file
@@ -0,0 +1,99 @@
+#include "resource_usage.hpp"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace resource_usage {
+
+#ifdef _WIN32
+
+size_t currentResidentBytes() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.WorkingSetSize;
+}
+
+size_t peakResidentBytes() {
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+bool resetPeakResident() {
+    return false;
+}
+
+#else
+
+namespace {
+
+// /proc/self/status の "key:  1234 kB" 行を読む（見つからなければ0）
+size_t readProcStatusKilobytes(const char* key) {
+    std::FILE* file = std::fopen("/proc/self/status", "r");
+    if (!file) {
+        return 0;
+    }
+    size_t key_length = std::strlen(key);
+    char line[256];
+    unsigned long long kilobytes = 0;
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::strncmp(line, key, key_length) == 0 && line[key_length] == ':') {
+            std::sscanf(line + key_length + 1, "%llu", &kilobytes);
+            break;
+        }
+    }
+    std::fclose(file);
+    return static_cast<size_t>(kilobytes) * 1024;
+}
+
+}
+
+size_t currentResidentBytes() {
+    return readProcStatusKilobytes("VmRSS");
+}
+
+size_t peakResidentBytes() {
+    size_t bytes = readProcStatusKilobytes("VmHWM");
+    if (bytes > 0) {
+        return bytes;
+    }
+    
+    // /proc がない環境（macOSなど）
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);          // バイト単位
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;   // KiB単位
+#endif
+}
+
+bool resetPeakResident() {
+    // "5" を書き込むとVmHWMが現在のRSSに戻る（Linux 4.0以降）
+    std::FILE* file = std::fopen("/proc/self/clear_refs", "w");
+    if (!file) {
+        return false;
+    }
+    bool ok = std::fputs("5", file) >= 0;
+    ok = (std::fclose(file) == 0) && ok;
+    return ok;
+}
+
+#endif
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * プロセスの常駐メモリ（RSS）の計測
+ *
+ * 計測できない環境では0を返す。
+ */
+namespace resource_usage {
+
+/**
+ * 現在の常駐メモリ
+ * @return バイト数
+ */
+size_t currentResidentBytes();
+
+/**
+ * プロセス開始（またはresetPeakResident()）以降の常駐メモリの最大値
+ * @return バイト数
+ */
+size_t peakResidentBytes();
+
+/**
+ * 常駐メモリの最大値を現在の値に戻す（区間ごとのピークを測る場合に使う）
+ *
+ * Linuxでのみ対応（/proc/self/clear_refs）。他の環境ではプロセス全体の最大値のまま。
+ * @return リセットできたかどうか
+ */
+bool resetPeakResident();
+
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <Eigen/Sparse>
+#include <Eigen/IterativeLinearSolvers>
+#include "reynolds_stencil.hpp"
+
+class ReynoldsOperator;
+
+namespace Eigen {
+namespace internal {
+// 疎行列と同じ性質を持つ演算子としてEigenの反復法に渡す
+template<>
+struct traits<ReynoldsOperator> : public Eigen::internal::traits<Eigen::SparseMatrix<double>> {};
+}
+}
+
+/**
+ * 行列を組み立てないReynolds演算子 -A（対称正定値）
+ *
+ * ReynoldsStencilの係数配列に対するベクトル化スイープで行列ベクトル積を計算する。
+ * CSRの間接参照がなく、1回の積あたりのメモリ転送量が疎行列より少ない。
+ * Eigen::ConjugateGradientにそのまま渡せる。
+ */
+class ReynoldsOperator : public Eigen::EigenBase<ReynoldsOperator> {
+public:
+    using Scalar = double;
+    using RealScalar = double;
+    using StorageIndex = int;
+    using Vector = Eigen::VectorXd;
+    enum {
+        ColsAtCompileTime = Eigen::Dynamic,
+        MaxColsAtCompileTime = Eigen::Dynamic,
+        IsRowMajor = false
+    };
+
+private:
+    const ReynoldsStencil* stencil_ptr;
+    mutable Vector work;     // 行列ベクトル積の作業領域
+
+public:
+    ReynoldsOperator() : stencil_ptr(nullptr) {}
+
+    /**
+     * ステンシルを関連付ける（ステンシルはこの演算子より長く生存すること）
+     */
+    void attach(const ReynoldsStencil& stencil) { stencil_ptr = &stencil; }
+
+    Index rows() const { return stencil_ptr->size(); }
+    Index cols() const { return stencil_ptr->size(); }
+
+    /**
+     * A x を作業領域に計算して返す（-A x はこの符号を反転したもの）
+     */
+    const Vector& applyStencil(const Vector& x) const {
+        stencil_ptr->apply(x, work);
+        return work;
+    }
+
+    /**
+     * -Aの対角成分
+     */
+    Vector diagonal() const { return -stencil_ptr->diagonal(); }
+
+    template<typename Rhs>
+    Eigen::Product<ReynoldsOperator, Rhs, Eigen::AliasFreeProduct>
+    operator*(const Eigen::MatrixBase<Rhs>& x) const {
+        return Eigen::Product<ReynoldsOperator, Rhs, Eigen::AliasFreeProduct>(*this, x.derived());
+    }
+};
+
+/**
+ * 行列を組み立てない演算子用の対角スケーリング前処理
+ */
+class StencilJacobiPreconditioner {
+private:
+    Eigen::VectorXd inv_diagonal;
+
+public:
+    StencilJacobiPreconditioner() {}
+
+    template<typename MatType>
+    StencilJacobiPreconditioner& analyzePattern(const MatType&) { return *this; }
+
+    template<typename MatType>
+    StencilJacobiPreconditioner& factorize(const MatType& mat) {
+        inv_diagonal = mat.diagonal().cwiseInverse();
+        return *this;
+    }
+
+    template<typename MatType>
+    StencilJacobiPreconditioner& compute(const MatType& mat) { return factorize(mat); }
+
+    template<typename Rhs>
+    auto solve(const Eigen::MatrixBase<Rhs>& b) const {
+        return inv_diagonal.cwiseProduct(b.derived());
+    }
+
+    Eigen::ComputationInfo info() { return Eigen::Success; }
+};
+
+namespace Eigen {
+namespace internal {
+template<typename Rhs>
+struct generic_product_impl<ReynoldsOperator, Rhs, SparseShape, DenseShape, GemvProduct>
+    : generic_product_impl_base<ReynoldsOperator, Rhs, generic_product_impl<ReynoldsOperator, Rhs>> {
+    using Scalar = typename Product<ReynoldsOperator, Rhs>::Scalar;
+
+    template<typename Dest>
+    static void scaleAndAddTo(Dest& dst, const ReynoldsOperator& lhs, const Rhs& rhs, const Scalar& alpha) {
+        // dst += alpha * (-A) rhs
+        dst.noalias() -= alpha * lhs.applyStencil(rhs);
+    }
+};
+}
+}
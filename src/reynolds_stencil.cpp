@@ -0,0 +1,107 @@
+#include "reynolds_stencil.hpp"
+#include <vector>
+
+ReynoldsStencil::ReynoldsStencil() : mx(0), my(0) {}
+
+void ReynoldsStencil::build(const Matrix& k, const Vector& xs, const Vector& ys) {
+    mx = static_cast<int>(xs.size()) - 2;
+    my = static_cast<int>(ys.size()) - 2;
+
+    int size = mx * my;
+    center.resize(size);
+    east.resize(size);
+    west.resize(size);
+    north.resize(size);
+    south.resize(size);
+
+    for (int i = 1; i <= my; ++i) {
+        double h_n = ys(i + 1) - ys(i);
+        double h_s = ys(i) - ys(i - 1);
+        double h_y = 0.5 * (h_n + h_s);
+        for (int j = 1; j <= mx; ++j) {
+            double h_e = xs(j + 1) - xs(j);
+            double h_w = xs(j) - xs(j - 1);
+            double h_x = 0.5 * (h_e + h_w);
+
+            // 節点の平均膜厚係数
+            double k_e = 0.5 * (k(i, j) + k(i, j + 1));
+            double k_w = 0.5 * (k(i, j) + k(i, j - 1));
+            double k_n = 0.5 * (k(i, j) + k(i + 1, j));
+            double k_s = 0.5 * (k(i, j) + k(i - 1, j));
+
+            int idx = (i - 1) * mx + (j - 1);
+            east(idx) = k_e / (h_e * h_x);
+            west(idx) = k_w / (h_w * h_x);
+            north(idx) = k_n / (h_n * h_y);
+            south(idx) = k_s / (h_s * h_y);
+            center(idx) = -(east(idx) + west(idx) + north(idx) + south(idx));
+        }
+    }
+}
+
+void ReynoldsStencil::apply(const Vector& x, Vector& y) const {
+    y.resize(size());
+
+    // 行ごとに連続した区間として処理し、Eigenのパケット演算でベクトル化する
+    for (int i = 0; i < my; ++i) {
+        int row = i * mx;
+        auto y_row = y.segment(row, mx).array();
+
+        y_row = center.segment(row, mx).array() * x.segment(row, mx).array();
+        if (i < my - 1) {
+            y_row += north.segment(row, mx).array() * x.segment(row + mx, mx).array();
+        }
+        if (i > 0) {
+            y_row += south.segment(row, mx).array() * x.segment(row - mx, mx).array();
+        }
+        if (mx > 1) {
+            y.segment(row, mx - 1).array() +=
+                east.segment(row, mx - 1).array() * x.segment(row + 1, mx - 1).array();
+            y.segment(row + 1, mx - 1).array() +=
+                west.segment(row + 1, mx - 1).array() * x.segment(row, mx - 1).array();
+        }
+    }
+}
+
+void ReynoldsStencil::residual(const Vector& b, const Vector& x, Vector& r) const {
+    apply(x, r);
+    r = b - r;
+}
+
+void ReynoldsStencil::smoothRedBlack(const Vector& b, Vector& x, int sweeps) const {
+    for (int sweep = 0; sweep < sweeps; ++sweep) {
+        for (int color = 0; color < 2; ++color) {
+            for (int i = 0; i < my; ++i) {
+                for (int j = (i + color) % 2; j < mx; j += 2) {
+                    int idx = i * mx + j;
+                    double sum = b(idx);
+                    if (j < mx - 1) sum -= east(idx) * x(idx + 1);
+                    if (j > 0) sum -= west(idx) * x(idx - 1);
+                    if (i < my - 1) sum -= north(idx) * x(idx + mx);
+                    if (i > 0) sum -= south(idx) * x(idx - mx);
+                    x(idx) = sum / center(idx);
+                }
+            }
+        }
+    }
+}
+
+ReynoldsStencil::SparseMatrix ReynoldsStencil::toSparse() const {
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(5 * size());
+
+    for (int i = 0; i < my; ++i) {
+        for (int j = 0; j < mx; ++j) {
+            int idx = i * mx + j;
+            triplets.emplace_back(idx, idx, center(idx));
+            if (j < mx - 1) triplets.emplace_back(idx, idx + 1, east(idx));
+            if (j > 0) triplets.emplace_back(idx, idx - 1, west(idx));
+            if (i < my - 1) triplets.emplace_back(idx, idx + mx, north(idx));
+            if (i > 0) triplets.emplace_back(idx, idx - mx, south(idx));
+        }
+    }
+
+    SparseMatrix M(size(), size());
+    M.setFromTriplets(triplets.begin(), triplets.end());
+    return M;
+}
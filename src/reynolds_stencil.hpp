@@ -0,0 +1,73 @@
+#pragma once
+
+#include <Eigen/Sparse>
+
+/**
+ * 構造格子上のReynolds方程式の5点ステンシル
+ *
+ * 節点の係数 k = h³/12μ から面の係数を隣接節点の平均で求める
+ * （SquareThinFilmFDM::buildSystemMatrixと同じ離散化）。
+ * 格子間隔は不等間隔でもよく、等間隔では k_e/dx² などに一致する。
+ * 未知数は内部点のみで、並びは行優先（idx = i * mx + j、iがy方向、jがx方向）。
+ * 境界値は含まない（同次ディリクレ条件として扱う）。
+ */
+class ReynoldsStencil {
+public:
+    using Matrix = Eigen::MatrixXd;
+    using SparseMatrix = Eigen::SparseMatrix<double>;
+    using Vector = Eigen::VectorXd;
+
+private:
+    int mx;          // x方向の内部点数
+    int my;          // y方向の内部点数
+
+    // 係数は5枚の連続した配列（SoA）として保持する
+    Vector center;   // 対角係数
+    Vector east;     // 東側の係数
+    Vector west;     // 西側の係数
+    Vector north;    // 北側の係数
+    Vector south;    // 南側の係数
+
+public:
+    ReynoldsStencil();
+
+    /**
+     * ステンシル係数を構築する
+     * @param k 節点の係数 h³/12μ（境界を含む ys.size() × xs.size()）
+     * @param xs x方向の節点座標
+     * @param ys y方向の節点座標
+     */
+    void build(const Matrix& k, const Vector& xs, const Vector& ys);
+
+    int cols() const { return mx; }
+    int rows() const { return my; }
+    int size() const { return mx * my; }
+
+    /**
+     * 対角係数
+     */
+    const Vector& diagonal() const { return center; }
+
+    /**
+     * y = A x（行単位のベクトル化スイープ）
+     */
+    void apply(const Vector& x, Vector& y) const;
+
+    /**
+     * r = b - A x
+     */
+    void residual(const Vector& b, const Vector& x, Vector& r) const;
+
+    /**
+     * 赤黒Gauss-Seidel法による平滑化
+     * @param b 右辺
+     * @param x 解（上書き）
+     * @param sweeps 反復回数（赤黒1組で1回）
+     */
+    void smoothRedBlack(const Vector& b, Vector& x, int sweeps) const;
+
+    /**
+     * 疎行列として組み立てる（最粗格子の直接法用）
+     */
+    SparseMatrix toSparse() const;
+};
@@ -0,0 +1,237 @@
+#include "solver_client.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace solver_protocol;
+
+namespace {
+
+// 受信バッファの先頭の処理済み部分を詰める目安 [バイト]
+constexpr size_t kCompactThreshold = 1 << 20;
+
+}
+
+SolverClient::SolverClient() : fd(-1), next_request_id(1), in_flight(0), receive_offset(0) {}
+
+SolverClient::~SolverClient() {
+    close();
+}
+
+uint32_t SolverClient::openGeometry(const GeometryRequest& geometry) {
+    return call(MessageType::OpenGeometry, &geometry, sizeof(geometry)).handle;
+}
+
+double SolverClient::solveForce(uint32_t handle, double bottom, double right, double top, double left) {
+    SolveRequest request{handle, 0, bottom, right, top, left};
+    return call(MessageType::SolveForce, &request, sizeof(request)).force;
+}
+
+SolverClient::Reply SolverClient::solveField(uint32_t handle, double bottom, double right, double top, double left) {
+    SolveRequest request{handle, 0, bottom, right, top, left};
+    return call(MessageType::SolveField, &request, sizeof(request));
+}
+
+void SolverClient::ping() {
+    call(MessageType::Ping, nullptr, 0);
+}
+
+void SolverClient::shutdown() {
+    call(MessageType::Shutdown, nullptr, 0);
+}
+
+uint32_t SolverClient::submitForce(uint32_t handle, double bottom, double right, double top, double left) {
+    SolveRequest request{handle, 0, bottom, right, top, left};
+    return submit(MessageType::SolveForce, &request, sizeof(request));
+}
+
+uint32_t SolverClient::submitField(uint32_t handle, double bottom, double right, double top, double left) {
+    SolveRequest request{handle, 0, bottom, right, top, left};
+    return submit(MessageType::SolveField, &request, sizeof(request));
+}
+
+uint32_t SolverClient::submit(MessageType type, const void* payload, size_t payload_bytes) {
+    if (fd < 0) {
+        throw std::runtime_error("Not connected to the solver server");
+    }
+    uint32_t id = next_request_id++;
+    MessageHeader header{kRequestMagic, static_cast<uint16_t>(type), 0, id, static_cast<uint32_t>(payload_bytes)};
+    const char* h = reinterpret_cast<const char*>(&header);
+    send_buffer.insert(send_buffer.end(), h, h + sizeof(header));
+    if (payload_bytes > 0) {
+        const char* p = static_cast<const char*>(payload);
+        send_buffer.insert(send_buffer.end(), p, p + payload_bytes);
+    }
+    in_flight++;
+    return id;
+}
+
+SolverClient::Reply SolverClient::call(MessageType type, const void* payload, size_t payload_bytes) {
+    if (in_flight > 0) {
+        throw std::runtime_error("Synchronous call with pipelined requests still pending");
+    }
+    uint32_t id = submit(type, payload, payload_bytes);
+    Reply reply;
+    receive(reply);
+    if (reply.request_id != id) {
+        throw std::runtime_error("Solver server replied out of order");
+    }
+    if (reply.status != Status::Ok) {
+        throw std::runtime_error("Solver server error: " + reply.error);
+    }
+    return reply;
+}
+
+void SolverClient::receive(Reply& reply) {
+    if (in_flight == 0) {
+        throw std::runtime_error("No request is waiting for a reply");
+    }
+    flush();
+
+    fill(sizeof(MessageHeader));
+    MessageHeader header;
+    std::memcpy(&header, receive_buffer.data() + receive_offset, sizeof(header));
+    if (header.magic != kResponseMagic) {
+        throw std::runtime_error("Invalid reply from the solver server");
+    }
+    fill(sizeof(MessageHeader) + header.payload_bytes);
+    const char* payload = receive_buffer.data() + receive_offset + sizeof(MessageHeader);
+
+    reply.request_id = header.request_id;
+    reply.type = static_cast<MessageType>(header.type);
+    reply.status = static_cast<Status>(header.status);
+    reply.error.clear();
+    if (reply.status != Status::Ok) {
+        reply.error.assign(payload, header.payload_bytes);
+    } else if (reply.type == MessageType::OpenGeometry && header.payload_bytes == sizeof(GeometryResponse)) {
+        GeometryResponse response;
+        std::memcpy(&response, payload, sizeof(response));
+        reply.handle = response.handle;
+    } else if (reply.type == MessageType::SolveForce && header.payload_bytes == sizeof(double)) {
+        std::memcpy(&reply.force, payload, sizeof(double));
+    } else if (reply.type == MessageType::SolveField && header.payload_bytes >= sizeof(FieldHeader)) {
+        FieldHeader field_header;
+        std::memcpy(&field_header, payload, sizeof(field_header));
+        size_t count = static_cast<size_t>(field_header.nx) * static_cast<size_t>(field_header.ny);
+        if (header.payload_bytes != sizeof(FieldHeader) + count * sizeof(double)) {
+            throw std::runtime_error("Invalid field reply from the solver server");
+        }
+        reply.nx = field_header.nx;
+        reply.ny = field_header.ny;
+        reply.force = field_header.force;
+        reply.field.resize(count);
+        std::memcpy(reply.field.data(), payload + sizeof(FieldHeader), count * sizeof(double));
+    }
+
+    receive_offset += sizeof(MessageHeader) + header.payload_bytes;
+    in_flight--;
+    if (receive_offset == receive_buffer.size()) {
+        receive_buffer.clear();
+        receive_offset = 0;
+    } else if (receive_offset > kCompactThreshold) {
+        receive_buffer.erase(receive_buffer.begin(), receive_buffer.begin() + receive_offset);
+        receive_offset = 0;
+    }
+}
+
+#ifdef _WIN32
+
+void SolverClient::connect(const std::string& socket_path) {
+    throw std::runtime_error("The solver server is not supported on this platform: " + socket_path);
+}
+
+void SolverClient::close() {}
+
+void SolverClient::flush() {
+    throw std::runtime_error("The solver server is not supported on this platform");
+}
+
+void SolverClient::fill(size_t) {
+    throw std::runtime_error("The solver server is not supported on this platform");
+}
+
+#else
+
+void SolverClient::connect(const std::string& socket_path) {
+    close();
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.empty() || socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Invalid socket path: " + socket_path);
+    }
+    std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Cannot create socket: ") + std::strerror(errno));
+    }
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::string reason = std::strerror(errno);
+        close();
+        throw std::runtime_error("Cannot connect to " + socket_path + ": " + reason);
+    }
+}
+
+void SolverClient::close() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    send_buffer.clear();
+    receive_buffer.clear();
+    receive_offset = 0;
+    in_flight = 0;
+}
+
+void SolverClient::flush() {
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+    size_t sent = 0;
+    while (sent < send_buffer.size()) {
+        ssize_t written = ::send(fd, send_buffer.data() + sent, send_buffer.size() - sent, flags);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Cannot send to the solver server: ") + std::strerror(errno));
+        }
+        sent += static_cast<size_t>(written);
+    }
+    send_buffer.clear();
+}
+
+void SolverClient::fill(size_t bytes) {
+    while (receive_buffer.size() - receive_offset < bytes) {
+        size_t position = receive_buffer.size();
+        size_t want = std::max<size_t>(bytes - (position - receive_offset), 64 * 1024);
+        receive_buffer.resize(position + want);
+        ssize_t received = ::recv(fd, receive_buffer.data() + position, want, 0);
+        if (received <= 0) {
+            receive_buffer.resize(position);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(received == 0 ? "Solver server closed the connection"
+                                                   : std::string("Cannot receive from the solver server: ") +
+                                                         std::strerror(errno));
+        }
+        receive_buffer.resize(position + static_cast<size_t>(received));
+    }
+}
+
+#endif
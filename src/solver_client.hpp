@@ -0,0 +1,138 @@
+#pragma once
+
+#include "solver_protocol.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * 常駐ソルバー（SolverServer）のクライアント
+ *
+ * 同期的に1要求ずつ答えを待つ関数（openGeometry, solveForce, solveField）と、
+ * 応答を待たずに要求を送るパイプライン用の関数（submitForce, submitField, receive）がある。
+ * パイプラインでは送信を flush() か receive() までまとめるので、1回の送信に多数の要求が入る。
+ * 応答は送った順に返る。
+ * 接続・通信の失敗とサーバーのエラー応答（同期関数のみ）は例外を送出する。
+ */
+class SolverClient {
+public:
+    /**
+     * 1つの応答
+     */
+    struct Reply {
+        uint32_t request_id = 0;
+        solver_protocol::MessageType type = solver_protocol::MessageType::Ping;
+        solver_protocol::Status status = solver_protocol::Status::Ok;
+        uint32_t handle = 0;          // OpenGeometry のハンドル
+        double force = 0.0;           // SolveForce・SolveField の合力 [N]
+        int nx = 0;                   // SolveField の格子点数
+        int ny = 0;
+        std::vector<double> field;    // SolveField の圧力分布（ny×nx、行 = y）
+        std::string error;            // status が Ok 以外のときのメッセージ
+    };
+
+private:
+    int fd;
+    uint32_t next_request_id;
+    size_t in_flight;                 // 送信（予約）済みで応答を受け取っていない要求の数
+    std::vector<char> send_buffer;    // まだ送っていない要求
+    std::vector<char> receive_buffer; // 受信済みで未処理のバイト列
+    size_t receive_offset;
+
+public:
+    SolverClient();
+    ~SolverClient();
+
+    SolverClient(const SolverClient&) = delete;
+    SolverClient& operator=(const SolverClient&) = delete;
+
+    /**
+     * サーバーに接続する（失敗した場合は例外を送出）
+     * @param socket_path ソケットファイルのパス
+     */
+    void connect(const std::string& socket_path);
+
+    void close();
+
+    bool isConnected() const { return fd >= 0; }
+
+    /**
+     * 格子を指定してソルバーのハンドルを得る（初回はサーバー側で分解・オペレータ構築を行う）
+     * @param geometry 格子の条件
+     * @return ハンドル
+     */
+    uint32_t openGeometry(const solver_protocol::GeometryRequest& geometry);
+
+    /**
+     * 合力を求める
+     * @param handle ハンドル
+     * @param bottom 下辺の圧力 [Pa]
+     * @param right 右辺の圧力 [Pa]
+     * @param top 上辺の圧力 [Pa]
+     * @param left 左辺の圧力 [Pa]
+     * @return 合力 [N]
+     */
+    double solveForce(uint32_t handle, double bottom, double right, double top, double left);
+
+    /**
+     * 圧力分布を求める
+     * @param handle ハンドル
+     * @param bottom 下辺の圧力 [Pa]
+     * @param right 右辺の圧力 [Pa]
+     * @param top 上辺の圧力 [Pa]
+     * @param left 左辺の圧力 [Pa]
+     * @return 応答（field, nx, ny, force）
+     */
+    Reply solveField(uint32_t handle, double bottom, double right, double top, double left);
+
+    /**
+     * 接続を確認する（往復の時間の計測にも使う）
+     */
+    void ping();
+
+    /**
+     * サーバーを終了させる
+     */
+    void shutdown();
+
+    /**
+     * 合力の要求を送信バッファに加える（応答は receive() で受け取る）
+     * @return 要求番号
+     */
+    uint32_t submitForce(uint32_t handle, double bottom, double right, double top, double left);
+
+    /**
+     * 圧力分布の要求を送信バッファに加える（応答は receive() で受け取る）
+     * @return 要求番号
+     */
+    uint32_t submitField(uint32_t handle, double bottom, double right, double top, double left);
+
+    /**
+     * 送信バッファの要求をすべて送る
+     */
+    void flush();
+
+    /**
+     * 次の応答を受け取る（送信バッファに残っている要求は先に送る）
+     * @param reply 応答（エラー応答でも例外は送出しない）
+     */
+    void receive(Reply& reply);
+
+    /**
+     * 応答を受け取っていない要求の数
+     */
+    size_t pending() const { return in_flight; }
+
+private:
+    uint32_t submit(solver_protocol::MessageType type, const void* payload, size_t payload_bytes);
+
+    /**
+     * 要求を1つ送り、その応答を受け取る（エラー応答なら例外を送出）
+     */
+    Reply call(solver_protocol::MessageType type, const void* payload, size_t payload_bytes);
+
+    /**
+     * 受信バッファに少なくとも bytes バイトたまるまで読む
+     */
+    void fill(size_t bytes);
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * 常駐ソルバー（SolverServer）とクライアント（SolverClient）の間のバイナリプロトコル
+ *
+ * ローカルのUnixドメインソケット上のバイト列で、各メッセージは16バイトのヘッダーと
+ * 可変長のペイロードからなる（数値はネイティブのバイト順、doubleはIEEE 754）。
+ * 同じマシン内の通信なのでバイト順は変換しない。異なる場合はマジックが一致しない。
+ *
+ *   要求   MessageHeader{kRequestMagic, 種類, 0, 要求番号, ペイロード長} + ペイロード
+ *   応答   MessageHeader{kResponseMagic, 種類, 状態, 要求番号, ペイロード長} + ペイロード
+ *
+ * 要求は応答を待たずに続けて送ってよい（パイプライン）。応答は同じ接続の要求の順に返り、
+ * 要求番号はクライアントが付けた値をそのまま返す。
+ *
+ *   種類          要求ペイロード              応答ペイロード
+ *   Ping          なし                        なし
+ *   OpenGeometry  GeometryRequest             GeometryResponse（同じ条件なら同じハンドル）
+ *   SolveForce    SolveRequest                double 合力 [N]
+ *   SolveField    SolveRequest                FieldHeader + 圧力 ny×nx（行 = y、double）
+ *   Shutdown      なし                        なし（応答を返したあとサーバーが終了する）
+ *
+ * 状態が Ok 以外の応答のペイロードはエラーメッセージ（UTF-8、終端なし）。
+ */
+namespace solver_protocol {
+
+// 既定のソケットファイル（カレントディレクトリ）
+constexpr const char* kDefaultSocketPath = "pressuredist.sock";
+
+constexpr uint32_t kRequestMagic = 0x51524450;   // "PDRQ"
+constexpr uint32_t kResponseMagic = 0x53524450;  // "PDRS"
+
+// 要求ペイロードの上限（これを超える要求は不正として接続を閉じる）
+constexpr uint32_t kMaxRequestPayload = 1u << 16;
+
+/**
+ * メッセージの種類
+ */
+enum class MessageType : uint16_t {
+    Ping = 1,
+    OpenGeometry = 2,
+    SolveForce = 3,
+    SolveField = 4,
+    Shutdown = 5
+};
+
+/**
+ * 応答の状態
+ */
+enum class Status : uint16_t {
+    Ok = 0,
+    BadRequest = 1,      // 種類・ペイロード長・パラメータが不正
+    UnknownHandle = 2,   // OpenGeometryで得ていないハンドル
+    SolveFailed = 3      // 分解・求解に失敗した
+};
+
+/**
+ * メッセージヘッダー（16バイト）
+ */
+struct MessageHeader {
+    uint32_t magic;
+    uint16_t type;           // MessageType
+    uint16_t status;         // Status（要求では0）
+    uint32_t request_id;     // クライアントが付ける番号（応答でそのまま返る）
+    uint32_t payload_bytes;  // ヘッダーに続くペイロードのバイト数
+};
+
+/**
+ * 格子の指定（OpenGeometry）。膜厚は一様（mainと同じ）
+ */
+struct GeometryRequest {
+    int32_t nx;              // x方向の格子点数
+    int32_t ny;              // y方向の格子点数
+    double width;            // 幅 [m]
+    double height;           // 高さ [m]
+    double viscosity;        // 粘度 [Pa・s]
+    double velocity;         // すべり速度 [m/s]
+};
+
+struct GeometryResponse {
+    uint32_t handle;         // SolveForce・SolveFieldで指定する番号
+    uint32_t reserved;
+};
+
+/**
+ * 各辺一定の境界圧力（SolveForce・SolveField）
+ */
+struct SolveRequest {
+    uint32_t handle;
+    uint32_t reserved;
+    double bottom;           // 下辺の圧力 [Pa]
+    double right;            // 右辺の圧力 [Pa]
+    double top;              // 上辺の圧力 [Pa]
+    double left;             // 左辺の圧力 [Pa]
+};
+
+/**
+ * SolveFieldの応答の先頭（続いて ny×nx 個のdouble）
+ */
+struct FieldHeader {
+    int32_t nx;
+    int32_t ny;
+    double force;            // 合力 [N]
+};
+
+static_assert(sizeof(MessageHeader) == 16, "MessageHeader must be 16 bytes");
+static_assert(sizeof(GeometryRequest) == 40, "GeometryRequest must be 40 bytes");
+static_assert(sizeof(GeometryResponse) == 8, "GeometryResponse must be 8 bytes");
+static_assert(sizeof(SolveRequest) == 40, "SolveRequest must be 40 bytes");
+static_assert(sizeof(FieldHeader) == 16, "FieldHeader must be 16 bytes");
+
+}
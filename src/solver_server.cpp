@@ -0,0 +1,493 @@
+#include "solver_server.hpp"
+#include "pressuredistsolver.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace solver_protocol;
+
+namespace {
+
+// 1つの格子の格子点数の上限（圧力分布の応答が大きくなりすぎないように）
+constexpr int64_t kMaxGridPoints = int64_t(1) << 24;
+
+// 1回の受信で読むバイト数
+constexpr size_t kReadChunk = 64 * 1024;
+
+// 待ち受けの間隔（requestStop() を確認する間隔）[ms]
+constexpr int kPollIntervalMs = 200;
+
+// 未送信の応答がこれを超えたら、送れるまでその接続の要求の受信・処理を止める [バイト]
+constexpr size_t kOutputHighWater = size_t(4) << 20;
+
+// 未処理の要求をこれ以上ためない（超えたら処理が進むまで受信を止める）[バイト]
+constexpr size_t kInputHighWater = size_t(1) << 20;
+
+// 1つの接続のバッファの上限（最大の圧力分布の応答より大きくとる）。超えたら接続を閉じる [バイト]
+constexpr size_t kMaxConnectionBuffer = size_t(256) << 20;
+
+// 送信済みの部分がこれを超えたら出力バッファの先頭を詰める [バイト]
+constexpr size_t kCompactThreshold = size_t(1) << 20;
+
+}
+
+SolverServer::SolverServer(const std::string& operator_cache_dir)
+    : operator_cache_dir(operator_cache_dir), listen_fd(-1), stop_requested(false) {}
+
+void SolverServer::appendResponse(std::vector<char>& output, MessageType type, Status status,
+                                  uint32_t request_id, const void* payload, size_t payload_bytes) {
+    MessageHeader header{kResponseMagic, static_cast<uint16_t>(type), static_cast<uint16_t>(status),
+                         request_id, static_cast<uint32_t>(payload_bytes)};
+    const char* h = reinterpret_cast<const char*>(&header);
+    output.insert(output.end(), h, h + sizeof(header));
+    if (payload_bytes > 0) {
+        const char* p = static_cast<const char*>(payload);
+        output.insert(output.end(), p, p + payload_bytes);
+    }
+}
+
+void SolverServer::appendError(std::vector<char>& output, MessageType type, Status status,
+                               uint32_t request_id, const std::string& message) {
+    appendResponse(output, type, status, request_id, message.data(), message.size());
+}
+
+bool SolverServer::preload(const GeometryRequest& request, uint32_t& handle) {
+    std::string error;
+    if (!openGeometry(request, handle, error)) {
+        std::cerr << "ソルバーを準備できません: " << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SolverServer::openGeometry(const GeometryRequest& request, uint32_t& handle, std::string& error) {
+    bool valid = request.nx >= 3 && request.ny >= 3 &&
+                 int64_t(request.nx) * int64_t(request.ny) <= kMaxGridPoints &&
+                 std::isfinite(request.width) && request.width > 0.0 &&
+                 std::isfinite(request.height) && request.height > 0.0 &&
+                 std::isfinite(request.viscosity) && request.viscosity > 0.0 &&
+                 std::isfinite(request.velocity);
+    if (!valid) {
+        error = "invalid geometry";
+        return false;
+    }
+
+    GeometryKey key(request.nx, request.ny, request.width, request.height, request.viscosity, request.velocity);
+    auto it = geometry_handles.find(key);
+    if (it != geometry_handles.end()) {
+        handle = it->second;
+        return true;
+    }
+
+    // 合力オペレータを準備する（キャッシュにあれば分解しない）
+    PD_TRACE_SCOPE("server.open_geometry");
+    auto solver = std::make_unique<SquareThinFilmFDM>(request.nx, request.ny, request.width, request.height,
+                                                      nullptr, request.viscosity, request.velocity);
+    bool built = operator_cache_dir.empty()
+        ? solver->buildAndFactorizeMatrix() && solver->buildForceOperator()
+        : solver->buildForceOperatorCached(operator_cache_dir);
+    if (!built) {
+        error = "failed to build the force operator";
+        return false;
+    }
+
+    handle = static_cast<uint32_t>(solvers.size());
+    solvers.push_back(std::move(solver));
+    geometry_handles.emplace(key, handle);
+    stats.geometries = solvers.size();
+    std::cout << "格子を準備しました: ハンドル " << handle << " (" << request.nx << "x" << request.ny
+              << ", 粘度 " << request.viscosity << ", 速度 " << request.velocity << ")" << std::endl;
+    return true;
+}
+
+bool SolverServer::ensureFactorized(SquareThinFilmFDM& solver) {
+    if (solver.isMatrixFactorized()) {
+        return true;
+    }
+    // 分解するとオペレータは無効になるので、もう一度用意する（キャッシュからの読み込みで済む）
+    PD_TRACE_SCOPE("server.factorize");
+    if (!solver.buildAndFactorizeMatrix()) {
+        return false;
+    }
+    return operator_cache_dir.empty() ? solver.buildForceOperator()
+                                      : solver.buildForceOperatorCached(operator_cache_dir);
+}
+
+bool SolverServer::processInput(Connection& connection) {
+    PD_TRACE_SCOPE("server.process");
+    size_t offset = 0;
+    const size_t available = connection.input.size();
+    bool valid = true;
+    uint64_t processed = 0;
+
+    // 未送信の応答がたまっている間は、相手が受け取るまで残りの要求を処理しない
+    while (available - offset >= sizeof(MessageHeader) &&
+           connection.output.size() - connection.output_sent <= kOutputHighWater) {
+        MessageHeader header;
+        std::memcpy(&header, connection.input.data() + offset, sizeof(header));
+        if (header.magic != kRequestMagic || header.payload_bytes > kMaxRequestPayload) {
+            // 区切りがわからなくなるので接続を閉じる
+            std::cerr << "不正な要求を受信したため接続を閉じます" << std::endl;
+            valid = false;
+            break;
+        }
+        if (available - offset < sizeof(MessageHeader) + header.payload_bytes) {
+            break;
+        }
+        const char* payload = connection.input.data() + offset + sizeof(MessageHeader);
+        offset += sizeof(MessageHeader) + header.payload_bytes;
+        processed++;
+
+        MessageType type = static_cast<MessageType>(header.type);
+        std::vector<char>& out = connection.output;
+        switch (type) {
+        case MessageType::Ping:
+            appendResponse(out, type, Status::Ok, header.request_id, nullptr, 0);
+            break;
+
+        case MessageType::Shutdown:
+            appendResponse(out, type, Status::Ok, header.request_id, nullptr, 0);
+            stop_requested.store(true);
+            break;
+
+        case MessageType::OpenGeometry: {
+            if (header.payload_bytes != sizeof(GeometryRequest)) {
+                appendError(out, type, Status::BadRequest, header.request_id, "bad payload size");
+                stats.errors++;
+                break;
+            }
+            GeometryRequest request;
+            std::memcpy(&request, payload, sizeof(request));
+            GeometryResponse response{0, 0};
+            std::string error;
+            if (openGeometry(request, response.handle, error)) {
+                appendResponse(out, type, Status::Ok, header.request_id, &response, sizeof(response));
+            } else {
+                appendError(out, type, Status::BadRequest, header.request_id, error);
+                stats.errors++;
+            }
+            break;
+        }
+
+        case MessageType::SolveForce:
+        case MessageType::SolveField: {
+            if (header.payload_bytes != sizeof(SolveRequest)) {
+                appendError(out, type, Status::BadRequest, header.request_id, "bad payload size");
+                stats.errors++;
+                break;
+            }
+            SolveRequest request;
+            std::memcpy(&request, payload, sizeof(request));
+            if (request.handle >= solvers.size()) {
+                appendError(out, type, Status::UnknownHandle, header.request_id, "unknown handle");
+                stats.errors++;
+                break;
+            }
+            SquareThinFilmFDM& solver = *solvers[request.handle];
+
+            if (type == MessageType::SolveForce) {
+                stats.force_requests++;
+                double force = solver.calculateForceFromEdges(request.bottom, request.right,
+                                                              request.top, request.left);
+                appendResponse(out, type, Status::Ok, header.request_id, &force, sizeof(force));
+                break;
+            }
+
+            stats.field_requests++;
+            PD_TRACE_SCOPE("server.solve_field");
+            solver.setEdgeBoundary(request.bottom, request.right, request.top, request.left);
+            if (!ensureFactorized(solver) || !solver.solveWithCachedMatrix()) {
+                appendError(out, type, Status::SolveFailed, header.request_id, "solve failed");
+                stats.errors++;
+                break;
+            }
+
+            // 圧力分布はヘッダーに続けて行ごとに書く（一時的な配列を作らない）
+            const SquareThinFilmFDM::Matrix& field = solver.getPressureField();
+            FieldHeader field_header{solver.getNx(), solver.getNy(), solver.calculateTotalForce()};
+            size_t field_bytes = sizeof(double) * static_cast<size_t>(field.size());
+            MessageHeader response{kResponseMagic, header.type, static_cast<uint16_t>(Status::Ok),
+                                   header.request_id, static_cast<uint32_t>(sizeof(field_header) + field_bytes)};
+            size_t position = out.size();
+            out.resize(position + sizeof(response) + sizeof(field_header) + field_bytes);
+            char* destination = out.data() + position;
+            std::memcpy(destination, &response, sizeof(response));
+            destination += sizeof(response);
+            std::memcpy(destination, &field_header, sizeof(field_header));
+            destination += sizeof(field_header);
+            for (Eigen::Index i = 0; i < field.rows(); ++i) {
+                for (Eigen::Index j = 0; j < field.cols(); ++j) {
+                    double value = field(i, j);
+                    std::memcpy(destination, &value, sizeof(value));
+                    destination += sizeof(value);
+                }
+            }
+            break;
+        }
+
+        default:
+            appendError(out, type, Status::BadRequest, header.request_id, "unknown message type");
+            stats.errors++;
+            break;
+        }
+    }
+
+    stats.requests += processed;
+    PD_TRACE_COUNT("server.requests", processed);
+    connection.input.erase(connection.input.begin(), connection.input.begin() + offset);
+    return valid;
+}
+
+#ifdef _WIN32
+
+SolverServer::~SolverServer() {}
+
+bool SolverServer::listen(const std::string& path) {
+    (void)path;
+    std::cerr << "サーバーモードはこのプラットフォームでは使えません" << std::endl;
+    return false;
+}
+
+bool SolverServer::run(const volatile std::sig_atomic_t*) {
+    return false;
+}
+
+void SolverServer::acceptConnections() {}
+
+bool SolverServer::flushOutput(Connection&) {
+    return false;
+}
+
+void SolverServer::closeConnection(Connection&) {}
+
+#else
+
+SolverServer::~SolverServer() {
+    for (Connection& connection : connections) {
+        closeConnection(connection);
+    }
+    if (listen_fd >= 0) {
+        ::close(listen_fd);
+        ::unlink(socket_path.c_str());
+    }
+}
+
+bool SolverServer::listen(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "ソケットのパスが長すぎます: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // 同じパスにあるのが前回異常終了したときのソケット（接続を拒否する）なら消す
+    // それ以外のファイルや使用中のソケットは消さずに失敗する
+    struct stat info;
+    if (::lstat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            std::cerr << "ソケット以外のファイルがあるため待ち受けできません: " << path << std::endl;
+            return false;
+        }
+        int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        bool stale = probe >= 0 &&
+                     ::connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 &&
+                     errno == ECONNREFUSED;
+        if (probe >= 0) {
+            ::close(probe);
+        }
+        if (!stale) {
+            std::cerr << "ソケットは使用中です: " << path << std::endl;
+            return false;
+        }
+        ::unlink(path.c_str());
+    }
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        std::cerr << "ソケットを作成できません: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listen_fd, SOMAXCONN) < 0) {
+        std::cerr << "ソケットで待ち受けできません: " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    ::fcntl(listen_fd, F_SETFL, ::fcntl(listen_fd, F_GETFL, 0) | O_NONBLOCK);
+    socket_path = path;
+    return true;
+}
+
+void SolverServer::acceptConnections() {
+    while (true) {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        Connection connection;
+        connection.fd = fd;
+        connections.push_back(std::move(connection));
+        stats.connections++;
+    }
+}
+
+bool SolverServer::flushOutput(Connection& connection) {
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+    while (connection.output_sent < connection.output.size()) {
+        ssize_t written = ::send(connection.fd, connection.output.data() + connection.output_sent,
+                                 connection.output.size() - connection.output_sent, flags);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.output_sent += static_cast<size_t>(written);
+        if (connection.output_sent > kCompactThreshold && connection.output_sent < connection.output.size()) {
+            // 少しずつ受け取る相手でも送信済みの部分がたまり続けないようにする
+            connection.output.erase(connection.output.begin(),
+                                    connection.output.begin() + connection.output_sent);
+            connection.output_sent = 0;
+        }
+    }
+    connection.output.clear();
+    connection.output_sent = 0;
+    return true;
+}
+
+void SolverServer::closeConnection(Connection& connection) {
+    if (connection.fd >= 0) {
+        ::close(connection.fd);
+        connection.fd = -1;
+    }
+}
+
+bool SolverServer::run(const volatile std::sig_atomic_t* stop_flag) {
+    if (listen_fd < 0) {
+        std::cerr << "ソケットで待ち受けていません。先にlisten()を呼び出してください。" << std::endl;
+        return false;
+    }
+
+    std::vector<pollfd> fds;
+    std::vector<char> buffer(kReadChunk);
+    // シグナルを受けると poll が EINTR で戻るので、フラグはすぐに確認される
+    while (!stop_requested.load() && !(stop_flag && *stop_flag)) {
+        fds.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const Connection& connection : connections) {
+            // 応答を受け取らずに要求を送り続ける相手からは、応答を送れるまで読まない
+            short events = 0;
+            if (!connection.read_closed && connection.input.size() < kInputHighWater &&
+                connection.output.size() - connection.output_sent <= kOutputHighWater) {
+                events |= POLLIN;
+            }
+            if (connection.output_sent < connection.output.size()) {
+                events |= POLLOUT;
+            }
+            fds.push_back({connection.fd, events, 0});
+        }
+
+        int ready = ::poll(fds.data(), fds.size(), kPollIntervalMs);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "poll に失敗しました: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (ready == 0) {
+            continue;
+        }
+
+        // pollに渡した接続だけを処理する（受け付けた接続は次の周回から）
+        const size_t polled = fds.size() - 1;
+        for (size_t k = 0; k < polled; ++k) {
+            Connection& connection = connections[k];
+            short revents = fds[k + 1].revents;
+            bool keep = true;
+            if ((revents & (POLLIN | POLLHUP | POLLERR)) && !connection.read_closed) {
+                // 届いている分を上限まで読んでからまとめて処理する
+                while (connection.input.size() < kInputHighWater) {
+                    ssize_t received = ::recv(connection.fd, buffer.data(), buffer.size(), 0);
+                    if (received > 0) {
+                        connection.input.insert(connection.input.end(), buffer.data(), buffer.data() + received);
+                        continue;
+                    }
+                    if (received < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (received == 0) {
+                        // 相手が送信を終えた（半閉鎖）。残りの応答を送り終えてから閉じる
+                        connection.read_closed = true;
+                    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                        keep = false;
+                    }
+                    break;
+                }
+            }
+
+            // 応答を送り切れる間は、ためておいた要求の処理と送信をくり返す
+            while (keep) {
+                size_t remaining = connection.input.size();
+                keep = processInput(connection) && flushOutput(connection);
+                if (!connection.output.empty() || connection.input.size() == remaining) {
+                    break;
+                }
+            }
+            if (connection.input.size() > kMaxConnectionBuffer || connection.output.size() > kMaxConnectionBuffer) {
+                std::cerr << "接続のバッファが上限を超えたため接続を閉じます" << std::endl;
+                keep = false;
+            }
+            // 送信を終えた相手には、完全な要求を処理して応答を送り終えたら閉じる
+            if (connection.read_closed && connection.output.empty()) {
+                keep = false;
+            }
+            if (!keep) {
+                closeConnection(connection);
+            }
+        }
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+                                         [](const Connection& c) { return c.fd < 0; }),
+                          connections.end());
+
+        if (fds[0].revents & POLLIN) {
+            acceptConnections();
+        }
+    }
+
+    // 終了前に残りの応答（Shutdownの応答を含む）を送る
+    for (Connection& connection : connections) {
+        ::fcntl(connection.fd, F_SETFL, ::fcntl(connection.fd, F_GETFL, 0) & ~O_NONBLOCK);
+        flushOutput(connection);
+        closeConnection(connection);
+    }
+    connections.clear();
+    return true;
+}
+
+#endif
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "solver_protocol.hpp"
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+class SquareThinFilmFDM;
+
+/**
+ * ソルバーを常駐させ、ローカルのUnixドメインソケットで境界圧力の要求に答えるサーバー
+ *
+ * 格子（格子点数・幅・高さ・粘度・速度）ごとに SquareThinFilmFDM を1つ保持し、
+ * 合力オペレータを一度だけ準備する（キャッシュディレクトリがあれば読み込むだけ）。
+ * 合力の要求はオペレータで O(1) で答え、圧力分布の要求は初回に分解して解く。
+ * プロトコルは solver_protocol.hpp を参照。
+ *
+ * 1スレッドのイベントループで複数の接続を扱う。各接続で届いた要求をまとめて処理し、
+ * 応答をまとめて書き出すので、応答を待たずに送られた要求（パイプライン）は
+ * システムコール1回あたり多数の要求として処理される。
+ * 未送信の応答がたまった接続からは、相手が受け取るまで要求を読まない（バッファは上限つき）。
+ * 相手が送信側だけを閉じた場合（半閉鎖）も、受信済みの要求の応答を送り終えてから閉じる。
+ * Windowsでは未対応（listen()がfalseを返す）。
+ */
+class SolverServer {
+public:
+    /**
+     * 処理した要求の統計
+     */
+    struct Stats {
+        uint64_t connections = 0;       // 受け付けた接続数
+        uint64_t requests = 0;          // 処理した要求数
+        uint64_t force_requests = 0;    // SolveForce の数
+        uint64_t field_requests = 0;    // SolveField の数
+        uint64_t errors = 0;            // Ok 以外で答えた要求数
+        uint64_t geometries = 0;        // 保持しているソルバーの数
+    };
+
+private:
+    // 格子の条件（格子点数・幅・高さ・粘度・速度）
+    using GeometryKey = std::tuple<int, int, double, double, double, double>;
+
+    struct Connection {
+        int fd = -1;
+        std::vector<char> input;        // 受信済みで未処理のバイト列
+        std::vector<char> output;       // 未送信の応答
+        size_t output_sent = 0;         // output のうち送信済みのバイト数
+        bool read_closed = false;       // 相手が送信を終えた（残りの応答を送ったら閉じる）
+    };
+
+    std::string socket_path;
+    std::string operator_cache_dir;     // 合力オペレータのキャッシュ（空なら使わない）
+    int listen_fd;
+    std::map<GeometryKey, uint32_t> geometry_handles;
+    std::vector<std::unique_ptr<SquareThinFilmFDM>> solvers; // ハンドル = 添字
+    std::vector<Connection> connections;
+    std::atomic<bool> stop_requested;
+    Stats stats;
+
+public:
+    /**
+     * コンストラクタ
+     * @param operator_cache_dir 合力オペレータのキャッシュディレクトリ（空なら使わない）
+     */
+    explicit SolverServer(const std::string& operator_cache_dir = "");
+    ~SolverServer();
+
+    SolverServer(const SolverServer&) = delete;
+    SolverServer& operator=(const SolverServer&) = delete;
+
+    /**
+     * ソケットを作成して接続を待ち受ける
+     *
+     * 同じパスに前回異常終了したときのソケットファイル（接続を拒否する）があれば削除する。
+     * ソケット以外のファイルや使用中のソケットがあれば削除せずに失敗する。
+     * @param path ソケットファイルのパス
+     * @return 成功したかどうか
+     */
+    bool listen(const std::string& path);
+
+    /**
+     * Shutdown 要求、requestStop() または stop_flag が0以外になるまで要求を処理する
+     * @param stop_flag nullptrでなければ待ち受けのたびに確認する終了フラグ（シグナルハンドラが設定する）
+     * @return 異常なく終了したかどうか
+     */
+    bool run(const volatile std::sig_atomic_t* stop_flag = nullptr);
+
+    /**
+     * run() を終了させる（別スレッドから呼べる。シグナルハンドラでは run() の stop_flag を使う）
+     */
+    void requestStop() { stop_requested.store(true); }
+
+    /**
+     * 要求を受け付ける前にソルバーを準備する
+     * @param request 格子の条件
+     * @param handle ハンドル
+     * @return 準備できたかどうか
+     */
+    bool preload(const solver_protocol::GeometryRequest& request, uint32_t& handle);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    void acceptConnections();
+
+    /**
+     * 受信済みの完全なメッセージを処理する（未送信の応答がたまったら途中で止める）
+     * @return 接続を続けるかどうか（プロトコル違反ならfalse）
+     */
+    bool processInput(Connection& connection);
+
+    /**
+     * 未送信の応答を書けるだけ書く
+     * @return 接続を続けるかどうか
+     */
+    bool flushOutput(Connection& connection);
+
+    void closeConnection(Connection& connection);
+
+    /**
+     * 格子の条件に対応するソルバーを用意する（なければ作成してオペレータを準備する）
+     * @param request 格子の条件
+     * @param handle ハンドル
+     * @param error 失敗したときの理由
+     * @return 用意できたかどうか
+     */
+    bool openGeometry(const solver_protocol::GeometryRequest& request, uint32_t& handle, std::string& error);
+
+    /**
+     * 圧力分布を解けるように分解する（オペレータはそのまま使えるようにする）
+     */
+    bool ensureFactorized(SquareThinFilmFDM& solver);
+
+    static void appendResponse(std::vector<char>& output, solver_protocol::MessageType type,
+                               solver_protocol::Status status, uint32_t request_id,
+                               const void* payload, size_t payload_bytes);
+
+    static void appendError(std::vector<char>& output, solver_protocol::MessageType type,
+                            solver_protocol::Status status, uint32_t request_id, const std::string& message);
+};
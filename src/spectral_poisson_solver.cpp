@@ -0,0 +1,78 @@
+#include "spectral_poisson_solver.hpp"
+#include <cmath>
+
+namespace {
+constexpr double pi = 3.14159265358979323846;
+}
+
+SpectralPoissonSolver::SpectralPoissonSolver() : mx(0), my(0) {
+    // 実数入力なので片側スペクトルのみ計算する
+    fft.SetFlag(Eigen::FFT<double>::HalfSpectrum);
+}
+
+void SpectralPoissonSolver::setup(int mx, int my, double dx, double dy, double coef) {
+    this->mx = mx;
+    this->my = my;
+
+    // T = tridiag(1, -2, 1) の固有値 λ_p = -4 sin²(π p / (2(m+1)))
+    Vector lambda_x(mx);
+    Vector lambda_y(my);
+    for (int p = 0; p < mx; ++p) {
+        double s = std::sin(pi * (p + 1) / (2.0 * (mx + 1)));
+        lambda_x(p) = -4.0 * s * s / (dx * dx);
+    }
+    for (int q = 0; q < my; ++q) {
+        double s = std::sin(pi * (q + 1) / (2.0 * (my + 1)));
+        lambda_y(q) = -4.0 * s * s / (dy * dy);
+    }
+
+    // DST-Iの逆変換は (2/(m+1)) * DST-I なので正規化係数をまとめておく
+    double normalization = (2.0 / (mx + 1)) * (2.0 / (my + 1));
+    inv_eigenvalues.resize(mx * my);
+    for (int q = 0; q < my; ++q) {
+        for (int p = 0; p < mx; ++p) {
+            inv_eigenvalues(q * mx + p) = normalization / (coef * (lambda_x(p) + lambda_y(q)));
+        }
+    }
+}
+
+void SpectralPoissonSolver::solve(const Vector& b, Vector& x) const {
+    x = b;
+
+    // 順変換（x方向→y方向）
+    for (int row = 0; row < my; ++row) {
+        dst(x.data() + row * mx, mx, 1);
+    }
+    for (int col = 0; col < mx; ++col) {
+        dst(x.data() + col, my, mx);
+    }
+
+    // 固有値で割る
+    x.array() *= inv_eigenvalues.array();
+
+    // 逆変換（正規化係数は固有値側に含めてある）
+    for (int row = 0; row < my; ++row) {
+        dst(x.data() + row * mx, mx, 1);
+    }
+    for (int col = 0; col < mx; ++col) {
+        dst(x.data() + col, my, mx);
+    }
+}
+
+void SpectralPoissonSolver::dst(double* data, int m, int stride) const {
+    // 奇拡張した長さ 2(m+1) の系列のFFTから求める
+    //   Y_k = -2i Σ x_j sin(π j k / (m+1))
+    int length = 2 * (m + 1);
+    fft_in.assign(length, 0.0);
+    for (int j = 0; j < m; ++j) {
+        double v = data[j * stride];
+        fft_in[j + 1] = v;
+        fft_in[length - j - 1] = -v;
+    }
+
+    fft.fwd(fft_out, fft_in);
+
+    for (int k = 0; k < m; ++k) {
+        data[k * stride] = -0.5 * fft_out[k + 1].imag();
+    }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <unsupported/Eigen/FFT>
+#include <complex>
+#include <vector>
+
+/**
+ * 一様係数の5点差分ラプラシアン（ディリクレ境界）に対する離散サイン変換(DST-I)直接法
+ *
+ * 係数 k が一定のとき、システム行列は
+ *   A = k * (T_x / dx² ⊗ I + I ⊗ T_y / dy²),  T = tridiag(1, -2, 1)
+ * となり、DST-Iで対角化できる。分解もフィルインも不要で O(N log N) で解ける。
+ * 未知数の並びは行優先（idx = row * mx + col、rowがy方向、colがx方向）。
+ */
+class SpectralPoissonSolver {
+public:
+    using Vector = Eigen::VectorXd;
+
+private:
+    int mx;                  // x方向の内部点数
+    int my;                  // y方向の内部点数
+    Vector inv_eigenvalues;  // 固有値の逆数（正規化係数を含む）
+
+    // DST用の作業領域（FFTの計画はサイズごとにキャッシュされる）
+    mutable Eigen::FFT<double> fft;
+    mutable std::vector<double> fft_in;
+    mutable std::vector<std::complex<double>> fft_out;
+
+public:
+    SpectralPoissonSolver();
+
+    /**
+     * 固有値を事前計算する
+     * @param mx x方向の内部点数
+     * @param my y方向の内部点数
+     * @param dx x方向格子間隔
+     * @param dy y方向格子間隔
+     * @param coef 一様な係数 h³/12μ
+     */
+    void setup(int mx, int my, double dx, double dy, double coef);
+
+    /**
+     * A x = b を解く
+     * @param b 右辺ベクトル（mx*my）
+     * @param x 解ベクトル（mx*my）
+     */
+    void solve(const Vector& b, Vector& x) const;
+
+private:
+    /**
+     * 長さmの系列にDST-I（正規化なし）を適用する（in-place）
+     * X_k = Σ_{j=1}^{m} x_j sin(π j k / (m+1))
+     */
+    void dst(double* data, int m, int stride) const;
+};
@@ -0,0 +1,91 @@
+#include "time_index.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+TimeIndex::TimeIndex() {}
+
+TimeIndex::TimeIndex(const std::vector<double>& time_values) {
+    build(time_values);
+}
+
+void TimeIndex::build(const std::vector<double>& time_values) {
+    // 行番号を時刻順に並べる（同じ時刻は行の順を保つ）
+    std::vector<size_t> order(time_values.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return time_values[a] < time_values[b];
+    });
+
+    times.clear();
+    rows.clear();
+    times.reserve(order.size());
+    rows.reserve(order.size());
+    for (size_t row : order) {
+        if (times.empty() || time_values[row] != times.back()) {
+            times.push_back(time_values[row]);
+            rows.push_back(row);
+        }
+    }
+}
+
+size_t TimeIndex::nearest(double t) const {
+    if (times.empty()) {
+        throw std::runtime_error("Time index is empty");
+    }
+
+    auto it = std::lower_bound(times.begin(), times.end(), t);
+    if (it == times.begin()) {
+        return rows.front();
+    }
+    if (it == times.end()) {
+        return rows.back();
+    }
+
+    size_t upper = it - times.begin();
+    size_t lower = upper - 1;
+    double diff_lower = std::abs(times[lower] - t);
+    double diff_upper = std::abs(times[upper] - t);
+    if (diff_lower < diff_upper) {
+        return rows[lower];
+    }
+    if (diff_upper < diff_lower) {
+        return rows[upper];
+    }
+    // 等距離なら先に現れる行
+    return std::min(rows[lower], rows[upper]);
+}
+
+double TimeIndex::sample(const std::vector<double>& values, double t, Interpolation mode) const {
+    if (mode == Interpolation::Nearest) {
+        return values[nearest(t)];
+    }
+    if (times.empty()) {
+        throw std::runtime_error("Time index is empty");
+    }
+
+    // t より後の最初の時刻
+    size_t upper = std::upper_bound(times.begin(), times.end(), t) - times.begin();
+    if (upper == 0) {
+        return values[rows.front()];
+    }
+    size_t lower = upper - 1;
+    if (mode == Interpolation::Hold || upper == times.size()) {
+        return values[rows[lower]];
+    }
+
+    double w = (t - times[lower]) / (times[upper] - times[lower]);
+    return (1.0 - w) * values[rows[lower]] + w * values[rows[upper]];
+}
+
+std::vector<double> TimeIndex::resample(const std::vector<double>& values,
+                                        const std::vector<double>& timeline,
+                                        Interpolation mode) const {
+    std::vector<double> result;
+    result.reserve(timeline.size());
+    for (double t : timeline) {
+        result.push_back(sample(values, t, mode));
+    }
+    return result;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * 時刻列のソート済み索引
+ *
+ * 一度だけソートしておき、任意の時刻に対する検索を二分探索で O(log N) で行う。
+ * 同じ時刻が複数行ある場合は最初の行を使う。
+ */
+class TimeIndex {
+public:
+    /**
+     * 時刻の間の値の求め方
+     */
+    enum class Interpolation {
+        Nearest,   // 最も近い時刻の値（等距離なら先の行）
+        Linear,    // 前後の時刻の値の線形補間
+        Hold       // 直前の時刻の値（0次ホールド）
+    };
+
+private:
+    std::vector<double> times;   // 重複を除いた昇順の時刻
+    std::vector<size_t> rows;    // 各時刻が最初に現れる行
+
+public:
+    TimeIndex();
+
+    /**
+     * 索引を構築する
+     * @param time_values 時刻の列（順不同、重複可）
+     */
+    explicit TimeIndex(const std::vector<double>& time_values);
+
+    /**
+     * 索引を構築する（O(N log N)）
+     * @param time_values 時刻の列（順不同、重複可）
+     */
+    void build(const std::vector<double>& time_values);
+
+    /**
+     * 重複を除いた時刻の数
+     */
+    size_t size() const { return times.size(); }
+
+    /**
+     * 重複を除いた昇順の時刻
+     */
+    const std::vector<double>& sortedTimes() const { return times; }
+
+    /**
+     * 最も近い時刻の行番号（CSVData::findClosestTimeIndexと同じ結果）
+     * @param t 時刻
+     * @return 行番号
+     */
+    size_t nearest(double t) const;
+
+    /**
+     * 指定時刻の値を求める（範囲外は端の値）
+     * @param values 時刻列と同じ行数の値の列
+     * @param t 時刻
+     * @param mode 補間方法
+     * @return 値
+     */
+    double sample(const std::vector<double>& values, double t, Interpolation mode) const;
+
+    /**
+     * 共通の時刻列へ値を再標本化する
+     * @param values 時刻列と同じ行数の値の列
+     * @param timeline 出力する時刻の列
+     * @param mode 補間方法
+     * @return timelineの各時刻の値
+     */
+    std::vector<double> resample(const std::vector<double>& values,
+                                 const std::vector<double>& timeline,
+                                 Interpolation mode) const;
+};
@@ -0,0 +1,72 @@
+#include "time_series_engine.hpp"
+#include "parallel_for.hpp"
+#include "instrumentation.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+TimeSeriesEngine::TimeSeriesEngine(const SquareThinFilmFDM& solver, int num_threads, size_t chunk_size)
+    : solver(solver), num_threads(num_threads), chunk_size(chunk_size) {}
+
+bool TimeSeriesEngine::run(const std::vector<double>& bottom_pressures,
+                           const std::vector<double>& right_pressures,
+                           const std::vector<double>& top_pressures,
+                           const std::vector<double>& left_pressures,
+                           std::vector<double>& forces,
+                           std::vector<Matrix>* fields,
+                           SquareThinFilmFDM::SolveStats* stats) const {
+    if (!solver.supportsConcurrentSolve()) {
+        std::cerr << "ソルバーが分解されていないか、並列求解に対応していないバックエンドです" << std::endl;
+        return false;
+    }
+
+    size_t num_steps = bottom_pressures.size();
+    if (right_pressures.size() != num_steps || top_pressures.size() != num_steps ||
+        left_pressures.size() != num_steps) {
+        std::cerr << "各辺の圧力の時系列の長さが一致しません" << std::endl;
+        return false;
+    }
+
+    // 出力位置を事前確保（各スレッドは自分のステップにのみ書き込む）
+    forces.assign(num_steps, 0.0);
+    if (fields) {
+        fields->assign(num_steps, Matrix());
+    }
+
+    int threads = resolveThreadCount(num_threads);
+    std::vector<SquareThinFilmFDM::Workspace> workspaces;
+    workspaces.reserve(threads);
+    for (int t = 0; t < threads; ++t) {
+        workspaces.push_back(solver.createWorkspace());
+    }
+
+    PD_TRACE_SCOPE("engine.run");
+    PD_TRACE_COUNT("engine.steps", num_steps);
+    std::atomic<bool> failed(false);
+    parallelFor(num_steps, threads, chunk_size, [&](size_t begin, size_t end, int thread_id) {
+        SquareThinFilmFDM::Workspace& ws = workspaces[thread_id];
+        for (size_t i = begin; i < end; ++i) {
+            Matrix* field = fields ? &(*fields)[i] : nullptr;
+            if (!solver.solveEdgeState(bottom_pressures[i], right_pressures[i],
+                                       top_pressures[i], left_pressures[i],
+                                       ws, forces[i], field)) {
+                failed = true;
+            }
+        }
+    });
+
+    if (stats) {
+        *stats = SquareThinFilmFDM::SolveStats{0, 0.0};
+        for (const auto& ws : workspaces) {
+            stats->iterations = std::max(stats->iterations, ws.worst_stats.iterations);
+            stats->residual = std::max(stats->residual, ws.worst_stats.residual);
+        }
+    }
+
+    if (failed) {
+        std::cerr << "一部の時間ステップで求解に失敗しました" << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include "pressuredistsolver.hpp"
+
+/**
+ * 時系列の並列求解エンジン
+ *
+ * 1つの分解済みソルバー（読み取り専用）を全スレッドで共有し、
+ * 各スレッドは自分の右辺・解ベクトルだけを使う。時間ステップはチャンク単位で
+ * スレッドに割り当て、結果は事前確保した出力位置に書き込むので順序は保たれる。
+ */
+class TimeSeriesEngine {
+public:
+    using Matrix = Eigen::MatrixXd;
+
+private:
+    const SquareThinFilmFDM& solver;
+    int num_threads;         // スレッド数（0以下ならハードウェアのスレッド数）
+    size_t chunk_size;       // 一度にスレッドへ割り当てるステップ数
+
+public:
+    /**
+     * コンストラクタ
+     * @param solver 分解済みのソルバー（supportsConcurrentSolve()がtrueであること）
+     * @param num_threads スレッド数（0以下ならハードウェアのスレッド数）
+     * @param chunk_size 一度にスレッドへ割り当てるステップ数
+     */
+    explicit TimeSeriesEngine(const SquareThinFilmFDM& solver, int num_threads = 0,
+                              size_t chunk_size = 16);
+
+    /**
+     * 各時間ステップの合力を並列に計算する
+     * @param bottom_pressures 各ステップの下辺の圧力 [Pa]
+     * @param right_pressures 各ステップの右辺の圧力 [Pa]
+     * @param top_pressures 各ステップの上辺の圧力 [Pa]
+     * @param left_pressures 各ステップの左辺の圧力 [Pa]
+     * @param forces 各ステップの合力 [N]（入力と同じ順序）
+     * @param fields nullptrでなければ各ステップの圧力分布を格納する
+     * @param stats nullptrでなければ全ステップでの最大の反復回数・相対残差を格納する
+     *              （反復改良を行うMixedPrecisionLUのみ、他は0）
+     * @return すべてのステップで解が成功したかどうか
+     */
+    bool run(const std::vector<double>& bottom_pressures,
+             const std::vector<double>& right_pressures,
+             const std::vector<double>& top_pressures,
+             const std::vector<double>& left_pressures,
+             std::vector<double>& forces,
+             std::vector<Matrix>* fields = nullptr,
+             SquareThinFilmFDM::SolveStats* stats = nullptr) const;
+};